@@ -1,11 +1,35 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <stack>
 #include <omp.h>
 #include <chrono>
 #include <queue>
+#include <deque>
+#include <thread>
+#include <climits>
+#include <atomic>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <stdexcept>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <sstream>
+#include <iomanip>
 #include <mpi.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
 
 
 #define BLOCKED -1
@@ -18,7 +42,59 @@
 #define HORIZONTAL 3
 #define VERTICAL 4
 
+#define ID_I1_VERTICAL 1
+#define ID_I1_HORIZONTAL 2
+#define ID_I2_VERTICAL 3
+#define ID_I2_HORIZONTAL 4
+
+#define CELL_ALIGNMENT 64
+#define MAX_BITBOARD_SIZE 64
+#define MAX_POOLED_GRIDS 1024
+
+#define BOUND_COUNT 0
+#define BOUND_RUNS 1
+
+#define SHORT_HORIZONTAL 1
+#define SHORT_VERTICAL 2
+#define DEAD_SQUARE 4
+
+#define SYMMETRY_FLIP_ROWS 0
+#define SYMMETRY_FLIP_COLUMNS 1
+#define SYMMETRY_ROTATE_180 2
+#define SYMMETRY_TRANSPOSE 3
+#define SYMMETRY_ANTI_TRANSPOSE 4
+#define SYMMETRY_ROTATE_90 5
+#define SYMMETRY_ROTATE_270 6
+
 #define THRESHOLD 10
+#define SOLVER_BATCH 4
+#define BATCH_SMALL_SQUARES 48
+
+#define SYMMETRY_COLUMNS 4
+#define TRANSPOSITION_MIN_SQUARES 16
+
+#define MIN_SPLIT_SQUARES 4
+
+#define JOBS_PER_WORKER 4
+#define MIN_DONATED_SQUARES 8
+#define DONATION_POLL_INTERVAL 1024
+#define JOBS_PER_BATCH 8
+#define PREFETCHED_BATCHES 2
+#define SLAVES_PER_GROUP 16
+
+#define CHECKPOINT_MAGIC 0x43565247
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_INTERVAL 60
+#define CHECKPOINT_JOBS 1024
+
+#define TRANSPOSITION_SIZE_LOG 20
+#define TRANSPOSITION_BUCKET_SIZE 4
+#define TRANSPOSITION_SEED 0x5eed
+
+#define PROFILE_MAX_ROWS 12
+#define PROFILE_MAX_STATES (1 << 22)
+#define PROFILE_MAX_MEMORY (1LL << 29)
+#define PROFILE_MAX_WORK (1LL << 26)
 
 using namespace std;
 
@@ -30,7 +106,6 @@ typedef std::chrono::high_resolution_clock Clock;
 class Point {
 public:
     Point(int x = 0, int y = 0);
-    Point(const Point & p);
 
     int getX() { return this->x; }
     int getY() { return this->y; }
@@ -47,11 +122,6 @@ Point::Point(int x, int y) {
     this->y = y;
 }
 
-Point::Point(const Point & p) {
-    this->x = p.x;
-    this->y = p.y;
-}
-
 istream & operator >> (istream &in,  Point &p)  {
 
     in >> p.y;
@@ -83,6 +153,18 @@ public:
 
     vector<Point> &getForbiddenPoints() { return this->forbiddenPoints; }
 
+    // maps the file and parses it in place, throws runtime_error with the file and line of a bad value
+    void load(const char * path);
+
+    // best price reachable by any mix of I1, I2 and uncovered squares, ignores the geometry
+    int getBestFillCost(int squares) { return this->bestFillCost[squares]; }
+
+    // symmetries of the grid that keep every forbidden point forbidden, found once the problem is loaded
+    vector<int> & getSymmetries() { return this->symmetries; }
+    Point mapSymmetric(int symmetry, int x, int y);
+    // the ones that swap rows with columns also turn horizontal blocks into vertical ones
+    bool isTransposing(int symmetry) { return symmetry >= SYMMETRY_TRANSPOSE; }
+
     friend istream & operator >> (istream &in,  CoverageProblem &c);
     friend ostream & operator << (ostream &out, const CoverageProblem &c);
 private:
@@ -97,6 +179,12 @@ private:
 
     vector<Point> forbiddenPoints;
 
+    // indexed by number of squares, built once after the problem is loaded
+    vector<int> bestFillCost;
+    vector<int> symmetries;
+
+    void buildBestFillCost();
+    void buildSymmetries();
     int calculateUpperBoundPrice();
 };
 
@@ -114,15 +202,138 @@ istream & operator >> (istream &in,  CoverageProblem &c)  {
     int numForbidden;
     in >> numForbidden;
 
+    c.forbiddenPoints.reserve(numForbidden);
     for (int i = 0; i < numForbidden; ++i) {
         Point point;
         in >> point;
         c.forbiddenPoints.push_back(point);
     }
 
+    c.buildBestFillCost();
+    c.buildSymmetries();
+
     return in;
 }
 
+// cursor over the mapped file, errors tell the line they were found on
+struct ProblemReader {
+    const char * cursor;
+    const char * end;
+    const char * path;
+    int line;
+
+    void skipSpace() {
+        while (this->cursor < this->end && isspace((unsigned char) *this->cursor)) {
+            if (*this->cursor == '\n') {
+                this->line++;
+            }
+            this->cursor++;
+        }
+    }
+
+    int readInt(const char * what) {
+
+        this->skipSpace();
+
+        bool isNegative = this->cursor < this->end && *this->cursor == '-';
+        if (isNegative) {
+            this->cursor++;
+        }
+
+        if (this->cursor == this->end || !isdigit((unsigned char) *this->cursor)) {
+            this->fail(string("expected ") + what);
+        }
+
+        long long value = 0;
+        while (this->cursor < this->end && isdigit((unsigned char) *this->cursor)) {
+            value = value * 10 + (*this->cursor - '0');
+            if (value > INT_MAX) {
+                this->fail(string(what) + " does not fit into an int");
+            }
+            this->cursor++;
+        }
+
+        return isNegative ? -value : value;
+    }
+
+    void fail(const string & message) {
+        throw runtime_error(string(this->path) + ":" + to_string(this->line) + ": " + message);
+    }
+};
+
+void CoverageProblem::load(const char * path) {
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        throw runtime_error(string(path) + ": " + strerror(errno));
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1 || fileStat.st_size == 0) {
+        close(fd);
+        throw runtime_error(string(path) + ": empty or unreadable file");
+    }
+
+    // the whole file is parsed straight from the page cache, nothing is copied into a stream buffer
+    size_t size = fileStat.st_size;
+    void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw runtime_error(string(path) + ": " + strerror(errno));
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    ProblemReader reader{(const char *) data, (const char *) data + size, path, 1};
+
+    try {
+        this->m = reader.readInt("row count");
+        this->n = reader.readInt("column count");
+        if (this->m <= 0 || this->n <= 0 || (long long) this->m * this->n > INT_MAX / 2) {
+            reader.fail("grid size " + to_string(this->m) + "x" + to_string(this->n) + " is out of range");
+        }
+
+        this->i1Length = reader.readInt("I1 length");
+        this->i2Length = reader.readInt("I2 length");
+        if (this->i1Length <= 0 || this->i2Length <= 0) {
+            reader.fail("block lengths must be positive");
+        }
+
+        this->i1Cost = reader.readInt("I1 cost");
+        this->i2Cost = reader.readInt("I2 cost");
+        this->penalization = reader.readInt("penalization");
+
+        int numForbidden = reader.readInt("forbidden point count");
+        if (numForbidden < 0 || numForbidden > this->m * this->n) {
+            reader.fail("forbidden point count " + to_string(numForbidden) + " is out of range");
+        }
+
+        // column goes first in the file, the same as operator >> of Point
+        this->forbiddenPoints.clear();
+        this->forbiddenPoints.reserve(numForbidden);
+        for (int i = 0; i < numForbidden; ++i) {
+            int y = reader.readInt("forbidden point column");
+            int x = reader.readInt("forbidden point row");
+            if (x < 0 || x >= this->m || y < 0 || y >= this->n) {
+                reader.fail("forbidden point " + to_string(y) + " " + to_string(x) + " lies outside the grid");
+            }
+            this->forbiddenPoints.emplace_back(x, y);
+        }
+
+        reader.skipSpace();
+        if (reader.cursor != reader.end) {
+            reader.fail("unexpected data after the last forbidden point");
+        }
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+
+    munmap(data, size);
+
+    this->buildBestFillCost();
+    this->buildSymmetries();
+}
+
 ostream & operator << (ostream &out, const CoverageProblem &c) {
 
     out << "Matrix size: ";
@@ -140,6 +351,75 @@ ostream & operator << (ostream &out, const CoverageProblem &c) {
     return out;
 }
 
+Point CoverageProblem::mapSymmetric(int symmetry, int x, int y) {
+
+    switch (symmetry) {
+        case SYMMETRY_FLIP_ROWS:
+            return Point(m - 1 - x, y);
+        case SYMMETRY_FLIP_COLUMNS:
+            return Point(x, n - 1 - y);
+        case SYMMETRY_ROTATE_180:
+            return Point(m - 1 - x, n - 1 - y);
+        case SYMMETRY_TRANSPOSE:
+            return Point(y, x);
+        case SYMMETRY_ANTI_TRANSPOSE:
+            return Point(n - 1 - y, m - 1 - x);
+        case SYMMETRY_ROTATE_90:
+            return Point(y, m - 1 - x);
+        default:
+            return Point(n - 1 - y, x);
+    }
+}
+
+void CoverageProblem::buildSymmetries() {
+
+    this->symmetries.clear();
+
+    vector<bool> isForbidden(m * n, false);
+    for (auto & point : this->forbiddenPoints) {
+        isForbidden[point.getX() * n + point.getY()] = true;
+    }
+
+    // a rectangle only has its reflections and the half turn, a square grid all eight
+    int candidates = m == n ? SYMMETRY_ROTATE_270 + 1 : SYMMETRY_TRANSPOSE;
+    for (int symmetry = 0; symmetry < candidates; ++symmetry) {
+
+        bool isInvariant = true;
+        for (auto & point : this->forbiddenPoints) {
+            Point image = this->mapSymmetric(symmetry, point.getX(), point.getY());
+            if (!isForbidden[image.getX() * n + image.getY()]) {
+                isInvariant = false;
+                break;
+            }
+        }
+
+        if (isInvariant) {
+            this->symmetries.push_back(symmetry);
+        }
+    }
+}
+
+void CoverageProblem::buildBestFillCost() {
+
+    int squares = m * n;
+
+    this->bestFillCost.assign(squares + 1, 0);
+
+    // every square is either left uncovered or it ends an I1 / I2 block
+    for (int i = 1; i <= squares; ++i) {
+        int best = this->bestFillCost[i - 1] + penalization;
+
+        if (i1Length > 0 && i >= i1Length) {
+            best = max(best, this->bestFillCost[i - i1Length] + i1Cost);
+        }
+        if (i2Length > 0 && i >= i2Length) {
+            best = max(best, this->bestFillCost[i - i2Length] + i2Cost);
+        }
+
+        this->bestFillCost[i] = best;
+    }
+}
+
 //int CoverageProblem::calculateUpperBoundPrice() {
 //
 //    int numCells = m * n - forbiddenPoints.size();
@@ -149,23 +429,41 @@ ostream & operator << (ostream &out, const CoverageProblem &c) {
 
 //______________________________________________________________
 
+// I1 and I2 in both orientations plus the empty block
+#define MAX_POSSIBLE_BLOCKS 5
+
 class Block {
 public:
-    Block(Point * cord, int type, int orientation, int id);
-    //~Block();
+    Block(Point cord = Point(), int type = 0, int orientation = 0, int id = 0);
 
-    Point * getCord() { return this->cord; };
+    Point & getCord() { return this->cord; };
     int getType() { return this->type; };
     int getOrientation() { return this->orientation; };
     int getId() { return this->id; };
 private:
-    Point * cord;
+    Point cord;
     int type;
     int orientation;
     int id;
 };
 
-Block::Block(Point * cord, int type, int orientation, int id) {
+// fixed capacity list of blocks, lives on the stack of whoever generates the moves
+class BlockList {
+public:
+    BlockList() { this->count = 0; }
+
+    void push_back(const Block & block) { this->blocks[this->count++] = block; }
+    int size() { return this->count; }
+
+    Block & operator [] (int i) { return this->blocks[i]; }
+    Block * begin() { return this->blocks; }
+    Block * end() { return this->blocks + this->count; }
+private:
+    Block blocks[MAX_POSSIBLE_BLOCKS];
+    int count;
+};
+
+inline Block::Block(Point cord, int type, int orientation, int id) {
 
     this->cord = cord;
     this->type = type;
@@ -173,55 +471,139 @@ Block::Block(Point * cord, int type, int orientation, int id) {
     this->id = id;
 }
 
-//Block::~Block() {
-//    delete cord;
-//}
+
 
 
 //______________________________________________________________
 
 
+// BLOCKED, EMPTY and block ids all fit into a byte
+typedef int8_t cell_t;
+
+// one placed block, grid keeps them in the order they were placed
+struct Placement {
+    int16_t x;
+    int16_t y;
+    int8_t type;
+    int8_t orientation;
+    int8_t id;
+};
+
+// free grid buffers of the calling thread, all grids of one problem share the buffer size
+class GridPool {
+public:
+    ~GridPool();
+
+    static GridPool & local();
+
+    void * acquire(size_t size);
+    void release(void * buffer, size_t size);
+private:
+    vector<void *> buffers;
+    size_t bufferSize = 0;
+
+    void clear();
+};
+
 class Grid {
 public:
-    Grid(CoverageProblem * problem);
+    Grid(CoverageProblem * problem, int boundType = BOUND_RUNS);
     Grid(Grid * grid, CoverageProblem * problem);
     ~Grid();
 
-    bool addBlockIfPossible(Block * block);
-    bool undoBlock(Block * block);
-    vector<Block*> generatePossibleBlocks(Point * cord);
+    bool addBlockIfPossible(Block & block);
+    bool addBlockById(int i, int j, int id);
+    bool addPlacement(Placement & placement);
+    bool undoBlock(Block & block);
+    BlockList generatePossibleBlocks(Point * cord);
 
     int getCost() { return this->cost; }
     int getCostWithoutPenalty(Point * cord);
-    int getGridValue(int i, int j) { return this->grid[i][j]; }
-    void updateGridValue(int i, int j, int newVal) { this->grid[i][j] = newVal; }
+    int getGridValue(int i, int j);
+    bool isEmpty(int i, int j) {
+        if (this->bitboard) {
+            return ((this->columnMask[j] >> i) & 1) == 0;
+        }
+        return this->cells[cellIndex(i, j)] == EMPTY;
+    }
+    void updateGridValue(int i, int j, int newVal);
+    // occupied squares of a column, only kept by grids up to MAX_BITBOARD_SIZE
+    bool isBitboard() { return this->bitboard; }
+    uint64_t getColumnMask(int j) { return this->columnMask[j]; }
     int upperBoundCost(Point * cord);
     int lowerBoundCost();
+    // EMPTY squares from cord to the end of the grid
+    int countUnsolvedSquares(Point * cord);
 
     void updateCost(int newCost) { this->cost = newCost; }
 
+    int getPlacementCount() { return this->placementCount; }
+    Placement & getPlacement(int i) { return this->placements[i]; }
+    void copyPlacements(vector<Placement> & out) { out.assign(this->placements, this->placements + this->placementCount); }
+
     friend ostream & operator << (ostream &out, const Grid &g);
 private:
     int rows;
     int columns;
-    int ** grid;
+    // single aligned buffer stored column by column, same order as the search walks it
+    cell_t * cells;
+    // SHORT_* and DEAD_SQUARE flags, only maintained for BOUND_RUNS
+    uint8_t * shortRuns;
+    // occupancy bitboards of grids up to 64x64, bit is set for every square that is not EMPTY
+    bool bitboard;
+    uint64_t * rowMask;
+    uint64_t * columnMask;
+    // number of EMPTY cells per column, updated on every placement
+    int * emptyInColumn;
+    // number of EMPTY cells per column no block can ever cover
+    int * deadInColumn;
+
+    int boundType;
+
+    // placed blocks, bitboard grids write their ids into cells only when they are read
+    Placement * placements;
+    int placementCount;
+    int placementCapacity;
+    mutable bool idsValid;
 
     int cost;
 
     CoverageProblem * problem;
 
 
+    int cellIndex(int i, int j) const { return j * this->rows + i; }
+
     void buildGrid(int m, int n);
+    void allocateCells();
+    size_t cellsSize() const;
+    size_t bufferSize() const;
+    size_t usedBufferSize() const;
+    void materializeIds() const;
+    void logPlacement(Block & block);
+    void unlogPlacement(Block & block);
+    void setOccupied(int i, int j, bool isOccupied);
+    int countDeadSquares(Point * cord);
+    int getMinBlockLength();
+    void refreshRuns(int x, int y, int orientation, int length);
+    void refreshRow(int i);
+    void refreshColumn(int j);
+    void updateDeadSquare(int i, int j);
     void addForbiddenPoints(CoverageProblem * problem);
     int getBlockSize(int type);
-    bool horizontalBlock(Block * block, int length);
-    bool verticalBlock(Block * block, int length);
+    bool horizontalBlock(Block & block, int length);
+    bool verticalBlock(Block & block, int length);
     void updateCost(int type, int length, bool isAdded = true);
-    bool isBlockValid(Block * block);
+    bool isBlockValid(Block & block);
 };
 
-Grid::Grid(CoverageProblem * problem) {
+// mask with the lowest "length" bits set
+static inline uint64_t lowBits(int length) {
+    return length >= 64 ? ~0ULL : (1ULL << length) - 1;
+}
+
+Grid::Grid(CoverageProblem * problem, int boundType) {
     this->problem = problem;
+    this->boundType = boundType;
 
     this->rows = this->problem->getRowSize();
     this->columns = this->problem->getColumnSize();
@@ -229,6 +611,15 @@ Grid::Grid(CoverageProblem * problem) {
     this->buildGrid(this->rows, this->columns);
     this->addForbiddenPoints(problem);
 
+    if (this->boundType == BOUND_RUNS) {
+        for (int i = 0; i < this->rows; ++i) {
+            this->refreshRow(i);
+        }
+        for (int j = 0; j < this->columns; ++j) {
+            this->refreshColumn(j);
+        }
+    }
+
     // calculate initial cost "penalization"
     int penalization = this->problem->getPenalization();
     this->cost = (((this->rows * this->columns) - problem->getForbiddenPoints().size())*penalization);
@@ -237,84 +628,139 @@ Grid::Grid(CoverageProblem * problem) {
 Grid::Grid(Grid * grid, CoverageProblem * problem) {
 
     this->problem = problem;
+    this->boundType = grid->boundType;
 
     this->rows = this->problem->getRowSize();
     this->columns = this->problem->getColumnSize();
 
     this->cost = grid->getCost();
 
-    this->buildGrid(this->rows, this->columns);
+    this->bitboard = grid->bitboard;
+    this->placementCount = grid->placementCount;
+    this->placementCapacity = grid->placementCapacity;
+    this->idsValid = grid->idsValid;
 
-    // TODO: faster copy!
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < columns; ++j) {
-            this->grid[i][j] = grid->getGridValue(i, j);
-        }
-    }
+    this->allocateCells();
+    memcpy(this->cells, grid->cells, grid->usedBufferSize());
 }
 
 Grid::~Grid() {
-
-    for (int i = 0; i < this->rows; i++) {
-        delete[] grid[i];
-    }
-    delete[] grid;
+    GridPool::local().release(this->cells, this->bufferSize());
 }
 
 int Grid::getCostWithoutPenalty(Point * cord) {
+    return getCost() - problem->getPenalization()*this->countUnsolvedSquares(cord);
+}
 
-    int unsolvedSquares = 0;
-    if (cord != NULL) {
-        int x = cord->getX();
-        int y = cord->getY();
+int Grid::countUnsolvedSquares(Point * cord) {
+
+    if (cord == NULL) {
+        return 0;
+    }
+
+    int x = cord->getX();
+    int y = cord->getY();
 
+    // rest of the current column, the following columns are kept counted
+    int unsolvedSquares = 0;
+    if (this->bitboard) {
+        uint64_t freeSquares = ~this->columnMask[y] & lowBits(rows) & ~lowBits(x);
+        unsolvedSquares = __builtin_popcountll(freeSquares);
+    } else {
+        cell_t * column = this->cells + cellIndex(0, y);
         for (int i = x; i < rows; i++) {
-            if (this->grid[i][y] == 0) {
+            if (column[i] == EMPTY) {
                 unsolvedSquares++;
             }
         }
+    }
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = y + 1; j < columns; ++j) {
-                if (this->grid[i][j] == 0) {
-                    unsolvedSquares++;
-                }
-            }
+    for (int j = y + 1; j < columns; ++j) {
+        unsolvedSquares += this->emptyInColumn[j];
+    }
+
+    return unsolvedSquares;
+}
+
+int Grid::countDeadSquares(Point * cord) {
+
+    if (cord == NULL) {
+        return 0;
+    }
+
+    int x = cord->getX();
+    int y = cord->getY();
+
+    int deadSquares = 0;
+    uint8_t * column = this->shortRuns + cellIndex(0, y);
+    for (int i = x; i < rows; i++) {
+        if (column[i] & DEAD_SQUARE) {
+            deadSquares++;
         }
-    } else {
-        unsolvedSquares = 0;
     }
 
-    return getCost() - problem->getPenalization()*unsolvedSquares;
+    for (int j = y + 1; j < columns; ++j) {
+        deadSquares += this->deadInColumn[j];
+    }
+
+    return deadSquares;
 }
 
-bool Grid::addBlockIfPossible(Block * block) {
+bool Grid::addBlockIfPossible(Block & block) {
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
 
-    int blockSize = this->getBlockSize(block->getType());
+    int blockSize = this->getBlockSize(block.getType());
 
     // blockSize == 0
     if (x >= this->rows || y >= this->columns || y < 0 || x < 0) {
         return false;
     }
 
-    if (block->getOrientation() == EMPTY) {
+    if (block.getOrientation() == EMPTY) {
         return true;
     }
 
-    if (block->getOrientation() == HORIZONTAL) {
+    if (block.getOrientation() == HORIZONTAL) {
         return this->horizontalBlock(block, blockSize);
     }
 
-    if (block->getOrientation() == VERTICAL) {
+    if (block.getOrientation() == VERTICAL) {
         return this->verticalBlock(block, blockSize);
     }
 
     return false;
 }
 
+bool Grid::addBlockById(int i, int j, int id) {
+
+    Point cord(i, j);
+
+    if (id == ID_I1_VERTICAL) {
+        Block block(cord, TYPE_1, VERTICAL, id);
+        return this->addBlockIfPossible(block);
+    } else if (id == ID_I1_HORIZONTAL) {
+        Block block(cord, TYPE_1, HORIZONTAL, id);
+        return this->addBlockIfPossible(block);
+    } else if (id == ID_I2_VERTICAL) {
+        Block block(cord, TYPE_2, VERTICAL, id);
+        return this->addBlockIfPossible(block);
+    } else if (id == ID_I2_HORIZONTAL) {
+        Block block(cord, TYPE_2, HORIZONTAL, id);
+        return this->addBlockIfPossible(block);
+    }
+
+    return false;
+}
+
+bool Grid::addPlacement(Placement & placement) {
+
+    Block block(Point(placement.x, placement.y), placement.type, placement.orientation, placement.id);
+
+    return this->addBlockIfPossible(block);
+}
+
 //int Grid::addBlock(Point * cord, int id, int type, bool isHorizontal) {
 //
 //    int x = cord->getX();
@@ -330,9 +776,9 @@ bool Grid::addBlockIfPossible(Block * block) {
 //    return isHorizontal ? this->horizontalBlock(cord, id, blockSize) : this->verticalBlock(cord, id, blockSize);
 //}
 
-vector<Block*> Grid::generatePossibleBlocks(Point * cord) {
+BlockList Grid::generatePossibleBlocks(Point * cord) {
 
-    vector<Block*> possibleBlocks;
+    BlockList possibleBlocks;
 
     int blockSizeI1 = this->getBlockSize(TYPE_1);
     int blockSizeI2 = this->getBlockSize(TYPE_2);
@@ -343,72 +789,71 @@ vector<Block*> Grid::generatePossibleBlocks(Point * cord) {
 //    cout << "Cord: [" << cord->getX() << ", " << cord->getY() << "]" << endl;
 //    cout << *this;
 
-    if (this->getGridValue(cord->getX(), cord->getY()) == BLOCKED || this->getGridValue(cord->getX(), cord->getY()) > 0) {
+    if (!this->isEmpty(cord->getX(), cord->getY())) {
         return possibleBlocks;
     }
 
     // I1 - horizontal
     if (cord->getY() + blockSizeI1 - 1 < this->columns) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_1, HORIZONTAL, 2);
+        Block newBlock(*cord, TYPE_1, HORIZONTAL, ID_I1_HORIZONTAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
-    // TODO: Add IDs
     // I1 - vertical
     if (cord->getX() + blockSizeI1 - 1 < this->rows) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_1, VERTICAL, 1);
+        Block newBlock(*cord, TYPE_1, VERTICAL, ID_I1_VERTICAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
     // I2 - vertical
     if (cord->getX() + blockSizeI2 - 1 < this->rows) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_2, VERTICAL, 3);
+        Block newBlock(*cord, TYPE_2, VERTICAL, ID_I2_VERTICAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
     // I2 - horizontal
     if (cord->getY() + blockSizeI2 - 1 < this->columns) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_2, HORIZONTAL, 4);
+        Block newBlock(*cord, TYPE_2, HORIZONTAL, ID_I2_HORIZONTAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
-    Block * emptyBlock = new Block(new Point(*cord), EMPTY, EMPTY, 0);
-    possibleBlocks.push_back(emptyBlock);
+    possibleBlocks.push_back(Block(*cord, EMPTY, EMPTY, 0));
 
     return possibleBlocks;
 }
 
-bool Grid::isBlockValid(Block * block) {
+bool Grid::isBlockValid(Block & block) {
+
 
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int orientation = block.getOrientation();
+    int blockSize = this->getBlockSize(block.getType());
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int orientation = block->getOrientation();
-    int blockSize = this->getBlockSize(block->getType());
+    if (this->bitboard) {
+        if (orientation == HORIZONTAL) {
+            return (this->rowMask[x] & (lowBits(blockSize) << y)) == 0;
+        } else if (orientation == VERTICAL) {
+            return (this->columnMask[y] & (lowBits(blockSize) << x)) == 0;
+        }
+        throw orientation;
+    }
 
     for (int i = 0; i < blockSize; ++i) {
         if (orientation == HORIZONTAL) {
-            if (this->grid[x][y + i] != 0) {
+            if (this->cells[cellIndex(x, y + i)] != 0) {
                 return false;
             }
         } else if (orientation == VERTICAL) {
-            if (this->grid[x + i][y] != 0) {
+            if (this->cells[cellIndex(x + i, y)] != 0) {
                 return false;
             }
         } else {
@@ -420,14 +865,42 @@ bool Grid::isBlockValid(Block * block) {
     return true;
 }
 
+int Grid::getGridValue(int i, int j) {
+
+    this->materializeIds();
+
+    return this->cells[cellIndex(i, j)];
+}
+
+void Grid::updateGridValue(int i, int j, int newVal) {
+
+    bool wasEmpty = this->isEmpty(i, j);
+    if (wasEmpty && newVal != EMPTY) {
+        this->emptyInColumn[j]--;
+    } else if (!wasEmpty && newVal == EMPTY) {
+        this->emptyInColumn[j]++;
+    }
+
+    this->materializeIds();
+    this->cells[cellIndex(i, j)] = (cell_t) newVal;
+    this->setOccupied(i, j, newVal != EMPTY);
+
+    if (this->boundType == BOUND_RUNS) {
+        this->refreshRow(i);
+        this->refreshColumn(j);
+    }
+}
+
 ostream & operator << (ostream &out, const Grid &g) {
 
 
     out << "[" << g.rows << ", " << g.columns<< "]" << endl;
 
+    g.materializeIds();
+
     for (int i = 0; i < g.rows; ++i) {
         for (int j = 0; j < g.columns; ++j) {
-            out << g.grid[i][j] << " ";
+            out << (int) g.cells[g.cellIndex(i, j)] << " ";
         }
         out << endl;
     }
@@ -438,19 +911,143 @@ ostream & operator << (ostream &out, const Grid &g) {
 }
 
 
-void Grid::buildGrid( int rows, int columns) {
+void Grid::buildGrid(int rows, int columns) {
+
+    this->rows = rows;
+    this->columns = columns;
+
+    this->bitboard = rows <= MAX_BITBOARD_SIZE && columns <= MAX_BITBOARD_SIZE;
+    this->placementCount = 0;
+    this->placementCapacity = rows * columns / max(1, this->getMinBlockLength()) + 1;
+    this->idsValid = true;
+
+    this->allocateCells();
+    memset(this->cells, EMPTY, this->cellsSize());
+    memset(this->shortRuns, 0, this->cellsSize());
+
+    if (this->bitboard) {
+        memset(this->rowMask, 0, (rows + columns) * sizeof(uint64_t));
+    }
+
+    for (int j = 0; j < columns; ++j) {
+        this->emptyInColumn[j] = rows;
+        this->deadInColumn[j] = 0;
+    }
+}
+
+void Grid::allocateCells() {
+
+    void * buffer = GridPool::local().acquire(this->bufferSize());
+
+    // run flags, bitboards, column counters and placements live right behind the cells
+    // so a copy is still one memcpy, the placements go last so only the used part is copied
+    char * bytes = static_cast<char *>(buffer);
+    this->cells = reinterpret_cast<cell_t *>(bytes);
+    this->shortRuns = reinterpret_cast<uint8_t *>(bytes + this->cellsSize());
+
+    uint64_t * masks = reinterpret_cast<uint64_t *>(bytes + 2 * this->cellsSize());
+    this->rowMask = this->bitboard ? masks : nullptr;
+    this->columnMask = this->bitboard ? masks + this->rows : nullptr;
+
+    this->emptyInColumn = reinterpret_cast<int *>(masks + (this->bitboard ? this->rows + this->columns : 0));
+    this->deadInColumn = this->emptyInColumn + this->columns;
+    this->placements = reinterpret_cast<Placement *>(this->deadInColumn + this->columns);
+}
+
+size_t Grid::cellsSize() const {
+
+    // rounded up so that the buffer always ends on the alignment boundary
+    size_t size = (size_t) this->rows * this->columns * sizeof(cell_t);
+    return (size + CELL_ALIGNMENT - 1) / CELL_ALIGNMENT * CELL_ALIGNMENT;
+}
+
+size_t Grid::bufferSize() const {
+    return this->usedBufferSize() + (this->placementCapacity - this->placementCount) * sizeof(Placement);
+}
+
+size_t Grid::usedBufferSize() const {
+
+    size_t masksSize = this->bitboard ? (this->rows + this->columns) * sizeof(uint64_t) : 0;
+
+    return 2 * this->cellsSize() + masksSize + 2 * this->columns * sizeof(int)
+        + this->placementCount * sizeof(Placement);
+}
+
+void Grid::materializeIds() const {
+
+    if (this->idsValid) {
+        return;
+    }
+
+    // squares freed since the last time may still hold an old id
+    for (int j = 0; j < this->columns; ++j) {
+        for (int i = 0; i < this->rows; ++i) {
+            if (((this->columnMask[j] >> i) & 1) == 0) {
+                this->cells[cellIndex(i, j)] = EMPTY;
+            }
+        }
+    }
 
-    this->grid = new int*[rows];
+    for (int k = 0; k < this->placementCount; ++k) {
+        Placement & placement = this->placements[k];
+        int length = placement.type == TYPE_1 ? this->problem->getI1Length() : this->problem->getI2Length();
 
-    for (int i = 0; i < rows; ++i) {
-        this->grid[i] = new int[columns];
+        for (int i = 0; i < length; ++i) {
+            if (placement.orientation == HORIZONTAL) {
+                this->cells[cellIndex(placement.x, placement.y + i)] = placement.id;
+            } else {
+                this->cells[cellIndex(placement.x + i, placement.y)] = placement.id;
+            }
+        }
     }
 
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < columns; ++j) {
-            this->grid[i][j] = 0;
+    this->idsValid = true;
+}
+
+void Grid::logPlacement(Block & block) {
+
+    Placement & placement = this->placements[this->placementCount++];
+    placement.x = (int16_t) block.getCord().getX();
+    placement.y = (int16_t) block.getCord().getY();
+    placement.type = (int8_t) block.getType();
+    placement.orientation = (int8_t) block.getOrientation();
+    placement.id = (int8_t) block.getId();
+
+    this->idsValid = !this->bitboard;
+}
+
+void Grid::unlogPlacement(Block & block) {
+
+    // blocks are undone in reverse order, so the match is almost always the last one
+    for (int k = this->placementCount - 1; k >= 0; --k) {
+        Placement & placement = this->placements[k];
+        if (placement.x == block.getCord().getX() && placement.y == block.getCord().getY()
+            && placement.id == block.getId()) {
+
+            memmove(this->placements + k, this->placements + k + 1, (this->placementCount - k - 1) * sizeof(Placement));
+            this->placementCount--;
+            this->idsValid = !this->bitboard;
+            return;
         }
     }
+
+    // undoing a block that was never placed is a bug of the caller
+    throw logic_error("undone block is not placed on the grid");
+}
+
+void Grid::setOccupied(int i, int j, bool isOccupied) {
+
+    if (!this->bitboard) {
+        return;
+    }
+
+    if (isOccupied) {
+        this->rowMask[i] |= 1ULL << j;
+        this->columnMask[j] |= 1ULL << i;
+    } else {
+        this->rowMask[i] &= ~(1ULL << j);
+        this->columnMask[j] &= ~(1ULL << i);
+    }
 }
 
 void Grid::addForbiddenPoints(CoverageProblem * problem) {
@@ -459,7 +1056,11 @@ void Grid::addForbiddenPoints(CoverageProblem * problem) {
         int x = point.getX();
         int y = point.getY();
 
-        this->grid[x][y] = BLOCKED;
+        if (this->cells[cellIndex(x, y)] == EMPTY) {
+            this->emptyInColumn[y]--;
+        }
+        this->cells[cellIndex(x, y)] = BLOCKED;
+        this->setOccupied(x, y, true);
     }
 }
 
@@ -474,27 +1075,43 @@ int Grid::getBlockSize(int type) {
     return 0;
 }
 
-bool Grid::horizontalBlock(Block * block, int length) {
+bool Grid::horizontalBlock(Block & block, int length) {
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int id = block->getId();
-    int type = block->getType();
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int id = block.getId();
+    int type = block.getType();
 
-    if (y + length - 1 > this->columns) {
+    if (y + length > this->columns) {
         return false;
     }
 
-    for (int i = 0; i < length; ++i) {
-        if (this->grid[x][y + i] != 0) {
+    if (this->bitboard) {
+        uint64_t span = lowBits(length) << y;
+        if (this->rowMask[x] & span) {
             return false;
         }
-    }
 
-    for (int i = 0; i < length; ++i) {
-        this->grid[x][y + i] = id;
+        this->rowMask[x] |= span;
+        for (int i = 0; i < length; ++i) {
+            this->columnMask[y + i] |= 1ULL << x;
+            this->emptyInColumn[y + i]--;
+        }
+    } else {
+        for (int i = 0; i < length; ++i) {
+            if (this->cells[cellIndex(x, y + i)] != 0) {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < length; ++i) {
+            this->cells[cellIndex(x, y + i)] = id;
+            this->emptyInColumn[y + i]--;
+        }
     }
 
+    this->logPlacement(block);
+    this->refreshRuns(x, y, HORIZONTAL, length);
 
     this->updateCost(type, length, true);
 
@@ -503,26 +1120,42 @@ bool Grid::horizontalBlock(Block * block, int length) {
 }
 
 
-bool Grid::verticalBlock(Block * block, int length) {
+bool Grid::verticalBlock(Block & block, int length) {
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int id = block->getId();
-    int type = block->getType();
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int id = block.getId();
+    int type = block.getType();
 
-    if (x + length - 1 > this->rows) {
+    if (x + length > this->rows) {
         return false;
     }
 
-    for (int i = 0; i < length; i++) {
-        if (this->grid[x + i][y] != 0) {
+    if (this->bitboard) {
+        uint64_t span = lowBits(length) << x;
+        if (this->columnMask[y] & span) {
             return false;
         }
-    }
 
-    for (int i = 0; i < length; i++) {
-        this->grid[x + i][y] = id;
+        this->columnMask[y] |= span;
+        for (int i = 0; i < length; i++) {
+            this->rowMask[x + i] |= 1ULL << y;
+        }
+    } else {
+        for (int i = 0; i < length; i++) {
+            if (this->cells[cellIndex(x + i, y)] != 0) {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < length; i++) {
+            this->cells[cellIndex(x + i, y)] = id;
+        }
     }
+    this->emptyInColumn[y] -= length;
+
+    this->logPlacement(block);
+    this->refreshRuns(x, y, VERTICAL, length);
 
     this->updateCost(type, length, true);
 
@@ -549,20 +1182,33 @@ void Grid::updateCost(int type, int length, bool isAdded) {
     }
 }
 
-bool Grid::undoBlock(Block * block) {
+bool Grid::undoBlock(Block & block) {
+
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int orientation = block.getOrientation();
+
+    // the empty block does not occupy any square
+    if (orientation == EMPTY) {
+        return true;
+    }
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int orientation = block->getOrientation();
+    int blockSize = this->getBlockSize(block.getType());
 
-    int blockSize = this->getBlockSize(block->getType());
+    // ids of bitboard grids are not written, the log tells whether the block is placed
+    this->unlogPlacement(block);
 
     for (int i = 0; i < blockSize; ++i) {
-        if (this->grid[x][y] != block->getId()) {
-            throw 42; // TODO: Beter exception
-        }
+        if (this->bitboard) {
+            this->setOccupied(x, y, false);
+        } else {
+            if (this->cells[cellIndex(x, y)] != block.getId()) {
+                throw 42; // TODO: Beter exception
+            }
 
-        this->grid[x][y] = 0;
+            this->cells[cellIndex(x, y)] = 0;
+        }
+        this->emptyInColumn[y]++;
 
         if (orientation == VERTICAL) {
             x++;
@@ -570,10 +1216,10 @@ bool Grid::undoBlock(Block * block) {
             y++;
         }
     }
-    // reduced the cost
-    this->updateCost(block->getType(), blockSize, false);
+    this->refreshRuns(block.getCord().getX(), block.getCord().getY(), orientation, blockSize);
 
-    delete block;
+    // reduced the cost
+    this->updateCost(block.getType(), blockSize, false);
 
     return true;
 }
@@ -587,523 +1233,2325 @@ int Grid::upperBoundCost(Point * cord) {
     // vraci maximalni cenu pro "number" nevyresenych policek
     // returns the maximal price for the "number" of unsolved squares
 
-    int unsolvedSquares = 0;
-    if (cord != NULL) {
-        int x = cord->getX();
-        int y = cord->getY();
+    int unsolvedSquares = this->countUnsolvedSquares(cord);
 
-        for (int i = x; i < rows; i++) {
-            if (this->grid[i][y] == 0) {
-                unsolvedSquares++;
-            }
-        }
+    if (this->boundType == BOUND_RUNS) {
+        // squares outside of any free run long enough for a block are never covered
+        int deadSquares = this->countDeadSquares(cord);
+        return problem->getBestFillCost(unsolvedSquares - deadSquares) + deadSquares * problem->getPenalization();
+    }
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = y + 1; j < columns; ++j) {
-                if (this->grid[i][j] == 0) {
-                    unsolvedSquares++;
-                }
+    return problem->getBestFillCost(unsolvedSquares);
+}
+
+int Grid::getMinBlockLength() {
+
+    int i1Length = this->problem->getI1Length();
+    int i2Length = this->problem->getI2Length();
+
+    if (i1Length <= 0) {
+        return i2Length;
+    }
+    if (i2Length <= 0) {
+        return i1Length;
+    }
+
+    return min(i1Length, i2Length);
+}
+
+void Grid::refreshRuns(int x, int y, int orientation, int length) {
+
+    if (this->boundType != BOUND_RUNS) {
+        return;
+    }
+
+    // only the runs crossing the changed squares can split or merge
+    if (orientation == HORIZONTAL) {
+        this->refreshRow(x);
+        for (int j = y; j < y + length; ++j) {
+            this->refreshColumn(j);
+        }
+    } else if (orientation == VERTICAL) {
+        this->refreshColumn(y);
+        for (int i = x; i < x + length; ++i) {
+            this->refreshRow(i);
+        }
+    }
+}
+
+void Grid::refreshRow(int i) {
+
+    int minLength = this->getMinBlockLength();
+
+    int j = 0;
+    while (j < columns) {
+        if (!this->isEmpty(i, j)) {
+            this->updateDeadSquare(i, j);
+            j++;
+            continue;
+        }
+
+        int start = j;
+        while (j < columns && this->isEmpty(i, j)) {
+            j++;
+        }
+
+        bool isShort = j - start < minLength;
+        for (int k = start; k < j; ++k) {
+            if (isShort) {
+                this->shortRuns[cellIndex(i, k)] |= SHORT_HORIZONTAL;
+            } else {
+                this->shortRuns[cellIndex(i, k)] &= ~SHORT_HORIZONTAL;
+            }
+            this->updateDeadSquare(i, k);
+        }
+    }
+}
+
+void Grid::refreshColumn(int j) {
+
+    int minLength = this->getMinBlockLength();
+
+    int i = 0;
+    while (i < rows) {
+        if (!this->isEmpty(i, j)) {
+            this->updateDeadSquare(i, j);
+            i++;
+            continue;
+        }
+
+        int start = i;
+        while (i < rows && this->isEmpty(i, j)) {
+            i++;
+        }
+
+        bool isShort = i - start < minLength;
+        for (int k = start; k < i; ++k) {
+            if (isShort) {
+                this->shortRuns[cellIndex(k, j)] |= SHORT_VERTICAL;
+            } else {
+                this->shortRuns[cellIndex(k, j)] &= ~SHORT_VERTICAL;
+            }
+            this->updateDeadSquare(k, j);
+        }
+    }
+}
+
+void Grid::updateDeadSquare(int i, int j) {
+
+    int index = cellIndex(i, j);
+    uint8_t flags = this->shortRuns[index];
+
+    bool isDead = this->isEmpty(i, j) && (flags & SHORT_HORIZONTAL) && (flags & SHORT_VERTICAL);
+    bool wasDead = (flags & DEAD_SQUARE) != 0;
+
+    if (isDead != wasDead) {
+        this->shortRuns[index] ^= DEAD_SQUARE;
+        this->deadInColumn[j] += isDead ? 1 : -1;
+    }
+}
+
+GridPool::~GridPool() {
+    this->clear();
+}
+
+GridPool & GridPool::local() {
+    static thread_local GridPool pool;
+    return pool;
+}
+
+void * GridPool::acquire(size_t size) {
+
+    if (size != this->bufferSize) {
+        this->clear();
+        this->bufferSize = size;
+        this->buffers.reserve(MAX_POOLED_GRIDS);
+    }
+
+    if (!this->buffers.empty()) {
+        void * buffer = this->buffers.back();
+        this->buffers.pop_back();
+        return buffer;
+    }
+
+    void * buffer = nullptr;
+    if (posix_memalign(&buffer, CELL_ALIGNMENT, size) != 0) {
+        throw bad_alloc();
+    }
+
+    return buffer;
+}
+
+void GridPool::release(void * buffer, size_t size) {
+
+    // grids deleted by another thread than the one that built them end up here as well
+    if (size != this->bufferSize || this->buffers.size() >= MAX_POOLED_GRIDS) {
+        free(buffer);
+        return;
+    }
+
+    this->buffers.push_back(buffer);
+}
+
+void GridPool::clear() {
+
+    for (auto buffer : this->buffers) {
+        free(buffer);
+    }
+    this->buffers.clear();
+}
+
+//______________________________________________________________
+
+// open search node, the executor owns its grid until the node is popped
+struct SearchNode {
+    Grid * grid;
+    Point cord;
+    int depth;
+    // checkpoint job the node was split off
+    int job;
+};
+
+// open nodes of one worker, the owner works at the back and thieves take from the front
+struct WorkerQueue {
+    omp_lock_t lock;
+    deque<SearchNode> nodes;
+    atomic<int> size;
+    atomic<int> shallowestDepth;
+};
+
+// per worker deques of open nodes, owner goes deep first and idle workers steal the shallowest node
+class WorkStealingExecutor {
+public:
+    WorkStealingExecutor(int workers);
+    ~WorkStealingExecutor();
+
+    void push(int worker, Grid * grid, Point & cord, int depth, int job);
+    bool pop(int worker, SearchNode & node);
+    bool tryPop(int worker, SearchNode & node);
+    void finish();
+
+    // while open, workers wait for nodes even when none are pending
+    void open() { this->isOpen = true; }
+    void close() { this->isOpen = false; }
+    int getPendingNodes() { return this->pendingNodes.load(); }
+
+    // busy worker should split its subtree, someone is waiting for more than it has queued
+    bool isHungry(int worker) {
+        return this->queues[worker]->size.load(memory_order_relaxed) < this->idleWorkers.load(memory_order_relaxed);
+    }
+private:
+    vector<WorkerQueue *> queues;
+    // nodes pushed and not finished yet, workers quit once it drops to zero on a closed executor
+    atomic<int> pendingNodes;
+    atomic<int> idleWorkers;
+    atomic<bool> isOpen;
+
+    bool popOwn(int worker, SearchNode & node);
+    bool steal(int thief, SearchNode & node);
+};
+
+WorkStealingExecutor::WorkStealingExecutor(int workers) {
+
+    this->pendingNodes = 0;
+    this->idleWorkers = 0;
+    this->isOpen = false;
+
+    for (int i = 0; i < workers; i++) {
+        WorkerQueue * queue = new WorkerQueue();
+        omp_init_lock(&queue->lock);
+        queue->size = 0;
+        queue->shallowestDepth = INT_MAX;
+        this->queues.push_back(queue);
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+
+    for (auto queue : this->queues) {
+        for (auto & node : queue->nodes) {
+            delete node.grid;
+        }
+        omp_destroy_lock(&queue->lock);
+        delete queue;
+    }
+}
+
+void WorkStealingExecutor::push(int worker, Grid * grid, Point & cord, int depth, int job) {
+
+    WorkerQueue * queue = this->queues[worker];
+
+    // counted before it is visible, so nobody sees zero pending nodes while it waits in the deque
+    this->pendingNodes++;
+
+    omp_set_lock(&queue->lock);
+    queue->nodes.push_back(SearchNode{grid, cord, depth, job});
+    queue->size.store(queue->nodes.size(), memory_order_relaxed);
+    queue->shallowestDepth.store(queue->nodes.front().depth, memory_order_relaxed);
+    omp_unset_lock(&queue->lock);
+}
+
+bool WorkStealingExecutor::pop(int worker, SearchNode & node) {
+
+    bool isIdle = false;
+
+    while (true) {
+
+        if (this->popOwn(worker, node) || this->steal(worker, node)) {
+            if (isIdle) {
+                this->idleWorkers--;
+            }
+            return true;
+        }
+
+        if (this->pendingNodes.load() == 0 && !this->isOpen.load()) {
+            if (isIdle) {
+                this->idleWorkers--;
             }
+            return false;
+        }
+
+        // busy workers split their subtrees as long as someone is idle
+        if (!isIdle) {
+            this->idleWorkers++;
+            isIdle = true;
         }
+
+        this_thread::yield();
     }
+}
+
+bool WorkStealingExecutor::tryPop(int worker, SearchNode & node) {
+    return this->popOwn(worker, node) || this->steal(worker, node);
+}
 
-    int i1Cost = problem->getI1Cost();
-    int i2Cost = problem->getI2Cost();
+void WorkStealingExecutor::finish() {
+    this->pendingNodes--;
+}
 
-    int i1Size = problem->getI1Length();
-    int i2Size = problem->getI2Length();
+bool WorkStealingExecutor::popOwn(int worker, SearchNode & node) {
 
-    int penalty = problem->getPenalization();
+    WorkerQueue * queue = this->queues[worker];
+    if (queue->size.load(memory_order_relaxed) == 0) {
+        return false;
+    }
 
-    int max = i2Cost * (unsolvedSquares/i2Size);
-    int reminder = unsolvedSquares % i2Size;
+    omp_set_lock(&queue->lock);
 
-    max += i1Cost * (reminder/i1Size);
-    reminder = reminder % i1Size;
-    max += reminder * penalty;
+    bool isPopped = !queue->nodes.empty();
+    if (isPopped) {
+        node = queue->nodes.back();
+        queue->nodes.pop_back();
+        queue->size.store(queue->nodes.size(), memory_order_relaxed);
+        queue->shallowestDepth.store(queue->nodes.empty() ? INT_MAX : queue->nodes.front().depth, memory_order_relaxed);
+    }
 
-    int val = 0;
-    for (int i = 0; i < (unsolvedSquares/i2Size); i++) {
+    omp_unset_lock(&queue->lock);
 
-        val = i2Cost * i;
+    return isPopped;
+}
 
-        reminder = unsolvedSquares - (i * i2Size);
-        val += i2Cost * (reminder/i2Size);
+bool WorkStealingExecutor::steal(int thief, SearchNode & node) {
 
-        reminder = reminder % i1Size;
-        val += reminder * penalty;
+    int workers = this->queues.size();
 
-        if (val > max) {
-            max = val;
+    // the shallowest open node has the biggest subtree, depths are read without locking just to pick the victim
+    int victim = -1;
+    int shallowest = INT_MAX;
+    for (int i = 1; i < workers; i++) {
+        int candidate = (thief + i) % workers;
+        int depth = this->queues[candidate]->shallowestDepth.load(memory_order_relaxed);
+        if (depth < shallowest) {
+            shallowest = depth;
+            victim = candidate;
         }
     }
 
-    return max;
+    if (victim == -1) {
+        return false;
+    }
+
+    WorkerQueue * queue = this->queues[victim];
+    omp_set_lock(&queue->lock);
+
+    bool isStolen = !queue->nodes.empty();
+    if (isStolen) {
+        node = queue->nodes.front();
+        queue->nodes.pop_front();
+        queue->size.store(queue->nodes.size(), memory_order_relaxed);
+        queue->shallowestDepth.store(queue->nodes.empty() ? INT_MAX : queue->nodes.front().depth, memory_order_relaxed);
+    }
+
+    omp_unset_lock(&queue->lock);
+
+    return isStolen;
 }
 
 //______________________________________________________________
 
+// subtree searched as one unit, it is done once it and everything split off it is searched
+struct CheckpointJob {
+    // cursor followed by the packed placements, the same as a serialized MPI job
+    vector<int> data;
+    atomic<int> pieces;
+};
 
-class Solver {
+// open jobs and the best solution of a search, a background thread writes them to a binary file
+class Checkpoint {
 public:
-    Solver(CoverageProblem * problem);
+    Checkpoint(const char * path, CoverageProblem * problem);
+    ~Checkpoint();
 
-    Grid * solveDistributed();
-    Grid * solveSequence();
-    Grid * solveTaskParallel(int depthThreshold);
-    Grid * solveDataParallel(int depth);
+    // reads the file of an earlier run, false when there is none, throws runtime_error for a file of another problem
+    bool load();
+    bool isResumed() { return this->isLoaded; }
+    int getCost() { return this->cost; }
+    vector<int> & getPlacements() { return this->placements; }
+    vector<vector<int>> & getLoadedJobs() { return this->loadedJobs; }
+    vector<int> & getJob(int job) { return this->jobs[job].data; }
+
+    // jobs are added before start() or by the only thread that finishes them
+    int addJob(const vector<int> & job);
+    void splitJob(int job) { this->jobs[job].pieces++; }
+    void finishJob(int job) { this->jobs[job].pieces--; }
+    void setIncumbent(int cost, const vector<int> & placements);
+
+    // writes every CHECKPOINT_INTERVAL seconds until stop(), which writes the final state
+    void start();
+    void stop();
 private:
+    string path;
     CoverageProblem * problem;
-    Grid * solutionGrid;
-
-    Grid * solveMPI(Grid * grid);
-    Grid * solveLoop(Grid * grid, int depth);
 
-    queue<pair<Grid*, Point*>> bfs(Grid * grid, Point * cord, int depth);
-    Grid * dfsRecursive(Grid * grid, Point * cord, int depth, int depthThreshold);
+    bool isLoaded;
+    vector<vector<int>> loadedJobs;
 
-    vector<int> jobSerialization(Grid * grid, Point * point);
-    pair<Grid*, Point*> jobDeserialization(vector<int> & serializedJob);
+    // guards the incumbent and adding jobs, the search itself only touches the atomic pieces
+    mutex lock;
+    deque<CheckpointJob> jobs;
+    int cost;
+    vector<int> placements;
 
-    Point * nextCord(Point * cord, Grid * grid);
+    thread writer;
+    bool isRunning;
+    condition_variable wakeUp;
 
-    const int TAG_INIT_SIZE = 0;
-    const int TAG_JOB = 1;
-    const int TAG_RESULT= 2;
-    const int TAG_DONE = 3;
-    const int TAG_FINISHED = 4;
+    void writeLoop();
+    void write();
+    // hash of the block settings and the sorted forbidden points, tells apart problems of the same size
+    int fingerprint();
 };
 
-Grid * Solver::solveSequence() {
 
-    Grid * grid = new Grid(problem);
+Checkpoint::Checkpoint(const char * path, CoverageProblem * problem) {
 
-    this->solutionGrid = new Grid(grid, problem);
-    Point * initCord = new Point(0, 0);
+    this->path = path;
+    this->problem = problem;
+    this->isLoaded = false;
+    this->cost = INT_MIN;
+    this->isRunning = false;
+}
+
+Checkpoint::~Checkpoint() {
+    this->stop();
+}
 
-    this->dfsRecursive(grid, initCord, 0, 0);
+bool Checkpoint::load() {
 
-    cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
-    cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
-    cout << "C: " << solutionGrid->getCost() << endl;
+    ifstream in(this->path, ios::in | ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
 
-    delete initCord;
+    // the whole file is a sequence of ints in the byte order of the machine that wrote it
+    in.seekg(0, ios::end);
+    vector<int> data(in.tellg() / sizeof(int));
+    in.seekg(0, ios::beg);
+    in.read((char *) data.data(), data.size() * sizeof(int));
+
+    // magic, version, rows, columns, fingerprint, cost and the placement count
+    if (data.size() < 7 || data[0] != CHECKPOINT_MAGIC || data[1] != CHECKPOINT_VERSION ||
+        data[2] != this->problem->getRowSize() || data[3] != this->problem->getColumnSize() ||
+        data[4] != this->fingerprint()) {
+        throw runtime_error(this->path + ": checkpoint does not belong to this problem");
+    }
 
-    return solutionGrid;
+    int counter = 7;
+    int placementCount = data[6];
+    if (placementCount < 0 || counter + placementCount >= (int) data.size()) {
+        throw runtime_error(this->path + ": checkpoint is truncated");
+    }
+
+    this->cost = data[5];
+    this->placements.assign(data.begin() + counter, data.begin() + counter + placementCount);
+    counter += placementCount;
+
+    // job count, then every job with its size in front
+    int jobCount = data[counter++];
+    for (int i = 0; i < jobCount; i++) {
+        int jobSize = counter < (int) data.size() ? data[counter] : -1;
+        if (jobSize < 2 || counter + 1 + jobSize > (int) data.size()) {
+            throw runtime_error(this->path + ": checkpoint is truncated");
+        }
+        this->loadedJobs.push_back(vector<int>(data.begin() + counter + 1, data.begin() + counter + 1 + jobSize));
+        counter += jobSize + 1;
+    }
+
+    this->isLoaded = true;
+
+    return true;
 }
 
-Grid * Solver::solveTaskParallel(int depthThreshold) {
+int Checkpoint::addJob(const vector<int> & job) {
 
-    Grid * grid = new Grid(problem);
+    lock_guard<mutex> guard(this->lock);
 
-    this->solutionGrid = new Grid(grid, problem);
-    Point * initCord = new Point(0, 0);
+    this->jobs.emplace_back();
+    this->jobs.back().data = job;
+    this->jobs.back().pieces = 1;
+
+    return this->jobs.size() - 1;
+}
+
+void Checkpoint::setIncumbent(int cost, const vector<int> & placements) {
+
+    lock_guard<mutex> guard(this->lock);
+
+    if (cost > this->cost) {
+        this->cost = cost;
+        this->placements = placements;
+    }
+}
+
+void Checkpoint::start() {
+
+    if (this->isRunning) {
+        return;
+    }
+
+    this->isRunning = true;
+    this->writer = thread(&Checkpoint::writeLoop, this);
+}
+
+void Checkpoint::stop() {
+
+    if (!this->isRunning) {
+        return;
+    }
 
-    // TODO: memory leak Point
-    # pragma omp parallel
     {
-        # pragma omp single
-        {
-            this->dfsRecursive(grid, initCord, 0, depthThreshold);
-        };
-    };
+        lock_guard<mutex> guard(this->lock);
+        this->isRunning = false;
+    }
+    this->wakeUp.notify_one();
+    this->writer.join();
 
-    cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
-    cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
-    cout << "C: " << solutionGrid->getCost() << endl;
+    // no job is open any more, a resumed run just returns the solution
+    this->write();
+}
 
-    delete initCord;
+void Checkpoint::writeLoop() {
 
-    return solutionGrid;
+    unique_lock<mutex> guard(this->lock);
+
+    while (this->isRunning) {
+        this->wakeUp.wait_for(guard, chrono::seconds(CHECKPOINT_INTERVAL));
+        if (!this->isRunning) {
+            break;
+        }
+
+        guard.unlock();
+        this->write();
+        guard.lock();
+    }
 }
 
-Grid * Solver::solveDataParallel(int depth) {
+int Checkpoint::fingerprint() {
 
-    Grid * grid = new Grid(problem);
+    // the order of the points in the input file does not matter
+    vector<pair<int, int>> points;
+    for (auto & point : this->problem->getForbiddenPoints()) {
+        points.push_back(make_pair(point.getY(), point.getX()));
+    }
+    sort(points.begin(), points.end());
 
-    this->solutionGrid = new Grid(grid, problem);
+    vector<int> values = {this->problem->getI1Length(), this->problem->getI2Length(),
+                          this->problem->getI1Cost(), this->problem->getI2Cost(), this->problem->getPenalization()};
+    for (auto & point : points) {
+        values.push_back(point.first);
+        values.push_back(point.second);
+    }
+
+    // FNV-1a over the bytes of the values
+    uint32_t hash = 2166136261u;
+    for (int value : values) {
+        for (int i = 0; i < 4; i++) {
+            hash = (hash ^ (((uint32_t) value >> (8 * i)) & 0xff)) * 16777619u;
+        }
+    }
+
+    return (int) hash;
+}
+
+void Checkpoint::write() {
 
-    // TODO: memory leak Point
-    # pragma omp parallel
+    vector<int> data;
     {
-        # pragma omp single
-        {
-            this->solveLoop(grid, depth);
-        };
-    };
+        lock_guard<mutex> guard(this->lock);
+
+        data.push_back(CHECKPOINT_MAGIC);
+        data.push_back(CHECKPOINT_VERSION);
+        data.push_back(this->problem->getRowSize());
+        data.push_back(this->problem->getColumnSize());
+        data.push_back(this->fingerprint());
+
+        // jobs go before the incumbent is read, whatever a finished job found is in it already
+        vector<int> openJobs;
+        openJobs.push_back(0);
+        for (auto & job : this->jobs) {
+            if (job.pieces.load() > 0) {
+                openJobs.push_back(job.data.size());
+                openJobs.insert(openJobs.end(), job.data.begin(), job.data.end());
+                openJobs[0]++;
+            }
+        }
+
+        data.push_back(this->cost);
+        data.push_back(this->placements.size());
+        data.insert(data.end(), this->placements.begin(), this->placements.end());
+        data.insert(data.end(), openJobs.begin(), openJobs.end());
+    }
+
+    // the search goes on while the file is written, it replaces the old one only once complete
+    string tmpPath = this->path + ".tmp";
+    ofstream out(tmpPath, ios::out | ios::binary | ios::trunc);
+    out.write((const char *) data.data(), data.size() * sizeof(int));
+    out.close();
+
+    if (!out.fail()) {
+        rename(tmpPath.c_str(), this->path.c_str());
+    }
+}
+
+//______________________________________________________________
+
+// one slot, the key is stored xor'ed with the data so a half written slot never matches
+struct TranspositionEntry {
+    atomic<uint64_t> check;
+    atomic<uint64_t> data;
+};
+
+// bounded table of the best price still reachable behind a column frontier, shared by all threads without locks
+class TranspositionTable {
+public:
+    TranspositionTable(CoverageProblem * problem);
+    ~TranspositionTable();
+
+    // Zobrist key of the cursor and the covered squares a block placed from it on can still touch
+    uint64_t hash(Grid * grid, Point * cord);
+
+    // false when nothing is known about the key
+    bool probe(uint64_t key, int & bound);
+    // squares tell how big the searched subtree was, small ones are replaced first
+    void store(uint64_t key, int bound, int squares);
+private:
+    int rows;
+    int columns;
+    // columns a horizontal block starting in the cursor column reaches
+    int reach;
+
+    vector<uint64_t> squareKeys;
+    vector<uint64_t> cursorKeys;
+    // forbidden squares never change, they are left out of the key
+    vector<uint64_t> forbiddenMask;
+
+    TranspositionEntry * entries;
+    uint64_t bucketMask;
+};
+
+
+TranspositionTable::TranspositionTable(CoverageProblem * problem) {
+
+    this->rows = problem->getRowSize();
+    this->columns = problem->getColumnSize();
+    this->reach = max(1, max(problem->getI1Length(), problem->getI2Length()));
+
+    mt19937_64 random(TRANSPOSITION_SEED);
+    this->squareKeys.resize(this->rows * this->columns);
+    this->cursorKeys.resize(this->rows * this->columns);
+    for (int k = 0; k < this->rows * this->columns; k++) {
+        this->squareKeys[k] = random();
+        this->cursorKeys[k] = random();
+    }
+
+    this->forbiddenMask.assign(this->columns, 0);
+    for (auto & point : problem->getForbiddenPoints()) {
+        this->forbiddenMask[point.getY()] |= 1ULL << point.getX();
+    }
+
+    // small grids have only a few frontiers, they do not need the full table
+    int freeSquares = this->rows * this->columns - problem->getForbiddenPoints().size();
+    int sizeLog = max(2, min(TRANSPOSITION_SIZE_LOG, freeSquares / 3));
+
+    this->entries = new TranspositionEntry[1ULL << sizeLog]();
+    this->bucketMask = ((1ULL << sizeLog) - 1) & ~(uint64_t) (TRANSPOSITION_BUCKET_SIZE - 1);
+}
+
+TranspositionTable::~TranspositionTable() {
+    delete [] this->entries;
+}
+
+uint64_t TranspositionTable::hash(Grid * grid, Point * cord) {
+
+    int x = cord->getX();
+    int y = cord->getY();
+
+    uint64_t key = this->cursorKeys[y * this->rows + x];
+
+    // squares before the cursor are final, columns past the reach hold nothing but forbidden squares
+    int lastColumn = min(this->columns, y + this->reach);
+    for (int j = y; j < lastColumn; j++) {
+        uint64_t covered = grid->getColumnMask(j) & ~this->forbiddenMask[j];
+        if (j == y) {
+            covered &= ~0ULL << x;
+        }
+
+        while (covered != 0) {
+            key ^= this->squareKeys[j * this->rows + __builtin_ctzll(covered)];
+            covered &= covered - 1;
+        }
+    }
+
+    return key;
+}
+
+bool TranspositionTable::probe(uint64_t key, int & bound) {
+
+    TranspositionEntry * bucket = this->entries + (key & this->bucketMask);
+
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++) {
+        uint64_t data = bucket[i].data.load(memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(memory_order_relaxed);
+        if (data != 0 && (check ^ data) == key) {
+            bound = (int) (uint32_t) data;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int bound, int squares) {
+
+    TranspositionEntry * bucket = this->entries + (key & this->bucketMask);
+
+    // the same frontier keeps the tighter bound, otherwise the smallest subtree makes room
+    TranspositionEntry * victim = bucket;
+    int victimSquares = INT_MAX;
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++) {
+        uint64_t data = bucket[i].data.load(memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(memory_order_relaxed);
+
+        if (data != 0 && (check ^ data) == key) {
+            if ((int) (uint32_t) data <= bound) {
+                return;
+            }
+            victim = bucket + i;
+            break;
+        }
+
+        int entrySquares = (int) (data >> 32);
+        if (entrySquares < victimSquares) {
+            victim = bucket + i;
+            victimSquares = entrySquares;
+        }
+    }
+
+    uint64_t data = ((uint64_t) squares << 32) | (uint32_t) bound;
+    victim->data.store(data, memory_order_relaxed);
+    victim->check.store(key ^ data, memory_order_relaxed);
+}
+
+//______________________________________________________________
+
+// block the dynamic programming may put on the cursor, with the price it adds
+struct ProfileBlock {
+    int type;
+    int orientation;
+    int id;
+    int length;
+    int gain;
+};
+
+// exact optimum of grids with few rows, walks the squares in the order of the search and keeps
+// the best price for every profile of blocks reaching past the cursor instead of branching
+class ProfileSolver {
+public:
+    ProfileSolver(CoverageProblem * problem);
+
+    // the table of profiles is small enough to be walked square by square, the kept layers fit into memory
+    // and the walk takes less than a second, above that the search usually cuts the grid down faster
+    bool isSolvable() {
+        return this->rows <= PROFILE_MAX_ROWS && this->stateCount <= PROFILE_MAX_STATES &&
+               this->memory <= PROFILE_MAX_MEMORY && this->work <= PROFILE_MAX_WORK;
+    }
+
+    // placements of an optimal grid, cost is set to the price they add to the empty one
+    vector<Placement> solve(int & cost);
+private:
+    int rows;
+    int columns;
+    // a profile holds a digit per row for the horizontal block crossing it and one for the vertical block below the cursor
+    int reach;
+    long long stateCount;
+    vector<int> power;
+    // columns between two kept layers and the bytes the layers, the table and the choices of a column may take
+    int stride;
+    long long memory;
+    // profiles moved over a square summed over the squares of the grid
+    long long work;
+
+    vector<uint8_t> isForbidden;
+    vector<ProfileBlock> blocks;
+
+    // index of a profile in the layer being built, -1 for profiles not reached yet
+    vector<int> slot;
+    // the layer being built, swapped with the current one after every square
+    vector<int> nextStates;
+    vector<int> nextValues;
+
+    int digit(int state, int position) { return state / this->power[position] % this->reach; }
+    bool isBlockValid(int state, int x, int y, ProfileBlock & block);
+    // moves the layer over one column, with parents it records the choice made on every square
+    void sweepColumn(int y, vector<int> & states, vector<int> & values,
+                     vector<vector<int>> * parents, vector<vector<int8_t>> * choices);
+};
+
+
+ProfileSolver::ProfileSolver(CoverageProblem * problem) {
+
+    this->rows = problem->getRowSize();
+    this->columns = problem->getColumnSize();
+    this->reach = max(1, max(problem->getI1Length(), problem->getI2Length()));
+
+    // digits go up to the length of the longest block minus the square it already covers
+    this->stateCount = 1;
+    for (int i = 0; i <= this->rows; i++) {
+        this->power.push_back((int) min(this->stateCount, (long long) INT_MAX));
+        this->stateCount = min(this->stateCount * this->reach, (long long) PROFILE_MAX_STATES + 1);
+    }
+
+    // about the square root of the column count, a layer is kept at every stride-th column and the rest is swept again
+    this->stride = 1;
+    while ((long long) this->stride * this->stride < this->columns) {
+        this->stride++;
+    }
+
+    // a column starts with no vertical block running, so its layer has at most reach^rows profiles
+    long long layerSize = this->stateCount / this->reach;
+    long long keptLayers = (this->columns + this->stride - 1) / this->stride + this->stride;
+    this->memory = keptLayers * layerSize * 2 * sizeof(int) + this->stateCount * (5 * sizeof(int) + this->rows * (sizeof(int) + 1));
+
+    // a free grid reaches about every profile, every column is swept once forward, once to rebuild the kept layers
+    // and once with the choices
+    this->work = this->stateCount * this->rows * this->columns * 3;
+
+    this->isForbidden.assign(this->rows * this->columns, 0);
+    for (auto & point : problem->getForbiddenPoints()) {
+        this->isForbidden[point.getY() * this->rows + point.getX()] = 1;
+    }
+
+    int penalization = problem->getPenalization();
+    int lengths[] = {problem->getI1Length(), problem->getI2Length()};
+    int costs[] = {problem->getI1Cost(), problem->getI2Cost()};
+    for (int type = TYPE_1; type <= TYPE_2; type++) {
+        int length = lengths[type - TYPE_1];
+        if (length <= 0) {
+            continue;
+        }
+
+        int gain = costs[type - TYPE_1] - length * penalization;
+        int verticalId = type == TYPE_1 ? ID_I1_VERTICAL : ID_I2_VERTICAL;
+        int horizontalId = type == TYPE_1 ? ID_I1_HORIZONTAL : ID_I2_HORIZONTAL;
+        this->blocks.push_back(ProfileBlock{type, VERTICAL, verticalId, length, gain});
+        this->blocks.push_back(ProfileBlock{type, HORIZONTAL, horizontalId, length, gain});
+    }
+}
+
+bool ProfileSolver::isBlockValid(int state, int x, int y, ProfileBlock & block) {
+
+    if (block.orientation == HORIZONTAL) {
+        if (y + block.length > this->columns) {
+            return false;
+        }
+        // other horizontal blocks of the row end before the cursor, vertical ones to the right are not placed yet
+        for (int j = y + 1; j < y + block.length; j++) {
+            if (this->isForbidden[j * this->rows + x]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (x + block.length > this->rows) {
+        return false;
+    }
+    for (int i = x + 1; i < x + block.length; i++) {
+        if (this->isForbidden[y * this->rows + i] || this->digit(state, i) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ProfileSolver::sweepColumn(int y, vector<int> & states, vector<int> & values,
+                                vector<vector<int>> * parents, vector<vector<int8_t>> * choices) {
+
+    for (int x = 0; x < this->rows; x++) {
+        int k = y * this->rows + x;
+
+        vector<int> & nextStates = this->nextStates;
+        vector<int> & nextValues = this->nextValues;
+        nextStates.clear();
+        nextValues.clear();
+        vector<int> * parent = parents != nullptr ? &(*parents)[x] : nullptr;
+        vector<int8_t> * choice = choices != nullptr ? &(*choices)[x] : nullptr;
+        if (parent != nullptr) {
+            parent->clear();
+            choice->clear();
+        }
+
+        auto relax = [&](int next, int value, int from, int block) {
+            int & index = this->slot[next];
+            if (index == -1) {
+                index = nextStates.size();
+                nextStates.push_back(next);
+                nextValues.push_back(value);
+                if (parent != nullptr) {
+                    parent->push_back(from);
+                    choice->push_back(block);
+                }
+            } else if (value > nextValues[index]) {
+                nextValues[index] = value;
+                if (parent != nullptr) {
+                    (*parent)[index] = from;
+                    (*choice)[index] = block;
+                }
+            }
+        };
+
+        for (int s = 0; s < (int) states.size(); s++) {
+            int state = states[s];
+            int horizontal = this->digit(state, x);
+            int vertical = this->digit(state, this->rows);
+            int rest = state - horizontal * this->power[x] - vertical * this->power[this->rows];
+
+            // covered square, the block covering it moves one square closer to its end
+            if (horizontal > 0) {
+                relax(rest + (horizontal - 1) * this->power[x], values[s], s, -1);
+                continue;
+            }
+            if (vertical > 0) {
+                relax(rest + (vertical - 1) * this->power[this->rows], values[s], s, -1);
+                continue;
+            }
+
+            relax(rest, values[s], s, -1);
+            if (this->isForbidden[k]) {
+                continue;
+            }
+
+            for (int b = 0; b < (int) this->blocks.size(); b++) {
+                ProfileBlock & block = this->blocks[b];
+                if (!this->isBlockValid(state, x, y, block)) {
+                    continue;
+                }
+
+                int position = block.orientation == HORIZONTAL ? x : this->rows;
+                relax(rest + (block.length - 1) * this->power[position], values[s] + block.gain, s, b);
+            }
+        }
+
+        for (int next : nextStates) {
+            this->slot[next] = -1;
+        }
+        states.swap(nextStates);
+        values.swap(nextValues);
+    }
+}
+
+vector<Placement> ProfileSolver::solve(int & cost) {
+
+    this->slot.assign(this->stateCount, -1);
+
+    // profiles reached at the start of every stride-th column with their best price, the choices are not kept
+    // for any square, the columns are swept again from the closest kept layer once the best grid is rebuilt
+    int segments = (this->columns + this->stride - 1) / this->stride;
+    vector<vector<int>> keptStates(segments);
+    vector<vector<int>> keptValues(segments);
+
+    vector<int> states(1, 0);
+    vector<int> values(1, 0);
+    for (int y = 0; y < this->columns; y++) {
+        if (y % this->stride == 0) {
+            keptStates[y / this->stride] = states;
+            keptValues[y / this->stride] = values;
+        }
+        this->sweepColumn(y, states, values, nullptr, nullptr);
+    }
+
+    // every block ends inside the grid, so all profiles left are complete grids
+    int best = max_element(values.begin(), values.end()) - values.begin();
+    cost = values[best];
+    int target = states[best];
+
+    vector<Placement> placements;
+    vector<vector<int>> parents(this->rows);
+    vector<vector<int8_t>> choices(this->rows);
+    vector<vector<int>> columnStates(this->stride);
+    vector<vector<int>> columnValues(this->stride);
+    for (int segment = segments - 1; segment >= 0; segment--) {
+        int first = segment * this->stride;
+        int last = min(this->columns, first + this->stride);
+
+        // layers at the start of every column of the segment
+        columnStates[0].swap(keptStates[segment]);
+        columnValues[0].swap(keptValues[segment]);
+        for (int y = first + 1; y < last; y++) {
+            columnStates[y - first] = columnStates[y - first - 1];
+            columnValues[y - first] = columnValues[y - first - 1];
+            this->sweepColumn(y - 1, columnStates[y - first], columnValues[y - first], nullptr, nullptr);
+        }
+
+        for (int y = last - 1; y >= first; y--) {
+            states = columnStates[y - first];
+            values = columnValues[y - first];
+            this->sweepColumn(y, states, values, &parents, &choices);
+
+            int s = find(states.begin(), states.end(), target) - states.begin();
+            for (int x = this->rows - 1; x >= 0; x--) {
+                if (choices[x][s] >= 0) {
+                    ProfileBlock & block = this->blocks[choices[x][s]];
+                    placements.push_back(Placement{(int16_t) x, (int16_t) y,
+                                                   (int8_t) block.type, (int8_t) block.orientation, (int8_t) block.id});
+                }
+                s = parents[x][s];
+            }
+            target = columnStates[y - first][s];
+        }
+    }
+
+    return placements;
+}
+
+//______________________________________________________________
+
+
+class Solver {
+public:
+    Solver(CoverageProblem * problem);
+    ~Solver();
+
+    Grid * solveDistributed();
+    Grid * solveSequence();
+    // exact and much faster than the search on grids with few rows
+    bool isProfileSolvable() { return ProfileSolver(this->problem).isSolvable(); }
+    Grid * solveProfile();
+    Grid * solveTaskParallel();
+    Grid * solveDataParallel(int statesPerThread);
+
+    void setCheckpoint(Checkpoint * checkpoint) { this->checkpoint = checkpoint; }
+    // off in batch mode, only the result line of every problem is printed
+    void setVerbose(bool isVerbose) { this->isVerbose = isVerbose; }
+private:
+    CoverageProblem * problem;
+    Grid * solutionGrid;
+    // best cost found so far, read without locking when pruning
+    atomic<int> bestCost;
+    // placements leading to the best grid, solutionGrid is rebuilt from them on demand
+    vector<Placement> bestPlacements;
+    int solutionCost;
+    // set while solveTaskParallel or the team of an MPI slave runs, subtrees are only split into its deques
+    WorkStealingExecutor * executor;
+    // fewest EMPTY squares a subtree needs to be split off, lowered while threads starve
+    atomic<int> splitCutoff;
+    // set on MPI slaves, their search hands a subtree back to the master when asked for it
+    bool isDonating;
+    atomic<bool> isSplitAsked;
+    // master asked for a subtree, thread 0 sends the next one split off
+    bool isDonationWanted;
+    vector<SearchNode> donatedNodes;
+    // best cost this slave and the master both know about, only thread 0 touches it
+    int sharedCost;
+    // rank 0 of it is the master of this slave, the sub-master of its group once the ranks are grouped
+    MPI_Comm masterComm;
+    // open jobs and the incumbent are written to it while the search runs, null without a checkpoint
+    Checkpoint * checkpoint;
+    // best price still reachable behind a column frontier, null when the grid keeps no bitboards
+    TranspositionTable * transpositions;
+    bool isVerbose;
+    // checkpoint job of the node the calling thread searches
+    static thread_local int activeJob;
+    // subtrees the calling thread handed over to other threads or ranks
+    static thread_local int splitCount;
+
+    Grid * solveMPI(Grid * grid);
+    void resumeIncumbent();
+    vector<SearchNode> expandFrontier(Grid * grid, int minNodes);
+    Grid * solveLoop(Grid * grid, int statesPerThread);
+    void trackJobs(vector<SearchNode> & frontier);
+    void expandNode(SearchNode & node, vector<SearchNode> & children);
+
+    Grid * dfsRecursive(Grid * grid, Point * cord, int depth);
+    void dfsChild(Grid * grid, Point * cord, int depth, int bound);
+    bool isWorthSplitting(Grid * grid, Point * cord, int bound);
+    bool isCanonical(Grid * grid, Point * cord, Point * next);
+    uint64_t transpositionKey(Grid * grid, Point * cord);
+    void storeTransposition(Grid * grid, Point * cord, uint64_t key, int splits);
+    bool splitForMaster(Grid * grid, Point * cord, int depth);
+    void communicate(WorkStealingExecutor & executor);
+    void pushBatch(WorkStealingExecutor & executor, vector<int> & batch);
+    bool pollMaster(WorkStealingExecutor & executor);
+    void donateSubtrees(WorkStealingExecutor & executor);
+    void shareBestCost();
+    void raiseBestCost(int cost);
+    void coordinate(MPI_Comm slaves, MPI_Comm master, queue<vector<int>> & q, int maxBatchJobs);
+    void receiveMessage(MPI_Comm comm, MPI_Status & status, vector<int> & message);
+    void sendBatch(queue<vector<int>> & q, MPI_Comm slaves, int slave, int jobCount);
+    // open job of the given batches the donated subtree was split off, -1 when none holds it
+    int findDonorJob(deque<vector<int>> & batches, vector<int> & subtree);
+    int maxBatchSize();
+
+    vector<int> jobSerialization(Grid * grid, Point * point);
+    pair<Grid*, Point*> jobDeserialization(const int * serializedJob, int jobSize);
+    vector<int> resultSerialization(Grid * grid);
+    void serializePlacements(Grid * grid, vector<int> & out);
+    Grid * deserializePlacements(const int * placements, int count);
+
+    void offerSolution(Grid * grid);
+    Grid * buildSolution();
+
+    Point * nextCord(Point * cord, Grid * grid);
+    bool nextCord(Point & cord, Grid * grid);
+
+    const int TAG_JOB = 1;
+    const int TAG_RESULT= 2;
+    const int TAG_DONE = 3;
+    const int TAG_FINISHED = 4;
+    const int TAG_SPLIT = 5;
+    const int TAG_DONATE = 6;
+    const int TAG_BOUND = 7;
+};
+
+Grid * Solver::solveSequence() {
+
+    Grid * grid = new Grid(problem);
+
+    this->solutionGrid = new Grid(grid, problem);
+    this->bestCost = this->solutionGrid->getCost();
+    this->solutionCost = this->solutionGrid->getCost();
+    this->resumeIncumbent();
+
+    // with a checkpoint the tree is searched as separate jobs, so that the file tells which are done
+    vector<SearchNode> frontier = this->expandFrontier(grid, this->checkpoint != nullptr ? CHECKPOINT_JOBS : 1);
+    this->trackJobs(frontier);
+
+    for (auto & node : frontier) {
+        this->dfsRecursive(node.grid, &node.cord, node.depth);
+        delete node.grid;
+
+        if (this->checkpoint != nullptr) {
+            this->checkpoint->finishJob(node.job);
+        }
+    }
+
+    if (this->checkpoint != nullptr) {
+        this->checkpoint->stop();
+    }
+
+    this->buildSolution();
+
+    if (this->isVerbose) {
+        cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
+        cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
+        cout << "C: " << solutionGrid->getCost() << endl;
+    }
+
+    return solutionGrid;
+}
+
+Grid * Solver::solveProfile() {
+
+    Grid * grid = new Grid(problem);
+
+    this->solutionGrid = new Grid(grid, problem);
+    this->bestCost = this->solutionGrid->getCost();
+    this->solutionCost = this->solutionGrid->getCost();
+    this->resumeIncumbent();
+
+    // every way to fill the grid is in the table of profiles, nothing is left to search
+    int cost;
+    vector<Placement> placements = ProfileSolver(problem).solve(cost);
+    for (auto & placement : placements) {
+        grid->addPlacement(placement);
+    }
+    this->offerSolution(grid);
+    delete grid;
+
+    // there are no jobs, the file gets the optimum with no job left open so that a resumed run just returns it
+    if (this->checkpoint != nullptr) {
+        this->checkpoint->start();
+        this->checkpoint->stop();
+    }
+
+    this->buildSolution();
+
+    if (this->isVerbose) {
+        cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
+        cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
+        cout << "C: " << solutionGrid->getCost() << endl;
+    }
+
+    return solutionGrid;
+}
+
+Grid * Solver::solveTaskParallel() {
+
+    Grid * grid = new Grid(problem);
+
+    this->solutionGrid = new Grid(grid, problem);
+    this->bestCost = this->solutionGrid->getCost();
+    this->solutionCost = this->solutionGrid->getCost();
+    this->resumeIncumbent();
+
+    // the executor owns the grids and deletes every node after its subtree is searched
+    int workers = omp_get_max_threads();
+    WorkStealingExecutor executor(workers);
+
+    vector<SearchNode> frontier = this->expandFrontier(grid, this->checkpoint != nullptr ? CHECKPOINT_JOBS : 1);
+    this->trackJobs(frontier);
+    for (auto & node : frontier) {
+        executor.push(0, node.grid, node.cord, node.depth, node.job);
+    }
+
+    this->executor = &executor;
+    # pragma omp parallel num_threads(workers)
+    {
+        int worker = omp_get_thread_num();
+
+        SearchNode node;
+        while (executor.pop(worker, node)) {
+            activeJob = node.job;
+            this->dfsRecursive(node.grid, &node.cord, node.depth);
+            delete node.grid;
+
+            if (this->checkpoint != nullptr) {
+                this->checkpoint->finishJob(node.job);
+            }
+            executor.finish();
+        }
+    };
+    this->executor = nullptr;
+
+    if (this->checkpoint != nullptr) {
+        this->checkpoint->stop();
+    }
+
+    this->buildSolution();
+
+    if (this->isVerbose) {
+        cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
+        cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
+        cout << "C: " << solutionGrid->getCost() << endl;
+    }
+
+    return solutionGrid;
+}
+
+Grid * Solver::solveDataParallel(int statesPerThread) {
+
+    Grid * grid = new Grid(problem);
+
+    this->solutionGrid = new Grid(grid, problem);
+    this->bestCost = this->solutionGrid->getCost();
+    this->solutionCost = this->solutionGrid->getCost();
+    this->resumeIncumbent();
+
+    // solveLoop owns the grid, it is deleted along with the frontier
+    this->solveLoop(grid, statesPerThread);
+
+    this->buildSolution();
+
+    if (this->isVerbose) {
+        cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
+        cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
+        cout << "C: " << solutionGrid->getCost() << endl;
+    }
+
+    return solutionGrid;
+}
+
+Grid * Solver::solveDistributed() {
+    Grid * grid = new Grid(problem);
+
+    this->solutionGrid = new Grid(grid, problem);
+    this->bestCost = this->solutionGrid->getCost();
+    this->solutionCost = this->solutionGrid->getCost();
+    this->resumeIncumbent();
+
+    // only thread 0 of the slave team talks to the master
+    int provided;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &provided);
+    this->solveMPI(grid);
+
+    this->buildSolution();
+
+    if (this->isVerbose) {
+        cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
+        cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
+        cout << "C: " << solutionGrid->getCost() << endl;
+    }
+
+    return solutionGrid;
+}
+
+
+thread_local int Solver::activeJob = 0;
+thread_local int Solver::splitCount = 0;
+
+Solver::~Solver() {
+    delete this->solutionGrid;
+    delete this->transpositions;
+}
+
+Solver::Solver(CoverageProblem * problem) {
+    this->problem = problem;
+    this->solutionGrid = nullptr;
+    this->executor = nullptr;
+    this->isDonating = false;
+    this->isSplitAsked = false;
+    this->isDonationWanted = false;
+    this->masterComm = MPI_COMM_WORLD;
+    this->checkpoint = nullptr;
+    this->isVerbose = true;
+
+    // the frontier is read from the column masks, only bitboard grids keep them
+    bool isBitboard = problem->getRowSize() <= MAX_BITBOARD_SIZE && problem->getColumnSize() <= MAX_BITBOARD_SIZE;
+    this->transpositions = isBitboard ? new TranspositionTable(problem) : nullptr;
+
+    // at first only the top of the tree is split
+    int freeSquares = problem->getRowSize() * problem->getColumnSize() - problem->getForbiddenPoints().size();
+    this->splitCutoff = max(MIN_SPLIT_SQUARES, freeSquares * 3 / 4);
+}
+
+Grid * Solver::solveMPI(Grid * grid) {
+
+    int rank;
+    int numProcesses;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+    int numSlaves = numProcesses - 1;
+
+    // the other ranks only seeded their incumbent from the checkpoint, rank 0 keeps track of the jobs
+    if (rank != 0) {
+        this->checkpoint = nullptr;
+    }
+
+    // flat topology, rank 0 coordinates every slave itself
+    MPI_Comm groupComm = MPI_COMM_WORLD;
+    MPI_Comm leaderComm = MPI_COMM_NULL;
+    bool isLeader = false;
+    int groupSize = numSlaves;
+
+    // too many slaves for one master, they are split into groups and the first rank of each leads it
+    bool isHierarchical = numSlaves > SLAVES_PER_GROUP;
+    if (isHierarchical) {
+
+        // every sub-master keeps at least one slave of its own
+        int groups = min((numSlaves + SLAVES_PER_GROUP - 1) / SLAVES_PER_GROUP, numSlaves / 2);
+        groupSize = numSlaves / groups;
+
+        // consecutive ranks share a group, so that it mostly stays within a node
+        int group = rank == 0 ? MPI_UNDEFINED : (rank - 1) * groups / numSlaves;
+        MPI_Comm_split(MPI_COMM_WORLD, group, rank, &groupComm);
+
+        int groupRank = -1;
+        if (groupComm != MPI_COMM_NULL) {
+            MPI_Comm_rank(groupComm, &groupRank);
+        }
+        isLeader = groupRank == 0;
+
+        // rank 0 hands out the jobs only to the sub-masters
+        MPI_Comm_split(MPI_COMM_WORLD, rank == 0 || isLeader ? 0 : MPI_UNDEFINED, rank, &leaderComm);
+    }
+
+    if (rank == 0) {
+
+        // first jobs come from the top of the tree, later ones are split off busy workers on demand
+        vector<SearchNode> frontier = this->expandFrontier(grid, numSlaves * JOBS_PER_WORKER);
+
+        queue<vector<int>> q;
+        for (auto & node : frontier) {
+            q.push(jobSerialization(node.grid, &node.cord));
+            delete node.grid;
+        }
+
+        // a sub-master passes the jobs on to its whole group, so its batches are as big as the group
+        if (isHierarchical) {
+            this->coordinate(leaderComm, MPI_COMM_NULL, q, JOBS_PER_BATCH * groupSize);
+        } else {
+            this->coordinate(MPI_COMM_WORLD, MPI_COMM_NULL, q, JOBS_PER_BATCH);
+        }
+
+        if (this->checkpoint != nullptr) {
+            this->checkpoint->stop();
+        }
+
+    } else if (isLeader) {
+
+        delete grid;
+
+        // the queue is filled only by the batches from rank 0
+        queue<vector<int>> q;
+        this->coordinate(groupComm, leaderComm, q, JOBS_PER_BATCH);
+
+    } else {
+
+        delete grid;
+        this->isDonating = true;
+        this->sharedCost = this->bestCost;
+        this->masterComm = groupComm;
+
+        int workers = omp_get_max_threads();
+        WorkStealingExecutor executor(workers);
+        executor.open();
+        this->executor = &executor;
+
+        // one team for the whole run, thread 0 talks to the master and feeds the jobs to the others
+        # pragma omp parallel num_threads(workers)
+        {
+            int worker = omp_get_thread_num();
+
+            if (worker == 0) {
+                this->communicate(executor);
+            } else {
+                SearchNode node;
+                while (executor.pop(worker, node)) {
+                    this->dfsRecursive(node.grid, &node.cord, node.depth);
+                    delete node.grid;
+                    executor.finish();
+                }
+            }
+        };
+
+        this->executor = nullptr;
+        this->isDonating = false;
+    }
+
+    if (isHierarchical) {
+        if (groupComm != MPI_COMM_NULL) {
+            MPI_Comm_free(&groupComm);
+        }
+        if (leaderComm != MPI_COMM_NULL) {
+            MPI_Comm_free(&leaderComm);
+        }
+    }
+
+    MPI_Finalize();
+
+    return this->solutionGrid;
+}
+
+void Solver::coordinate(MPI_Comm slaves, MPI_Comm master, queue<vector<int>> & q, int maxBatchJobs) {
+
+    int numProcesses;
+    MPI_Comm_size(slaves, &numProcesses);
+    int numSlaves = numProcesses - 1;
+
+    // batches sent to a slave and not answered yet, the first one is searched and the rest wait in its buffer
+    vector<int> sentBatches(numProcesses, 0);
+    vector<bool> isAskedToSplit(numProcesses, false);
+
+    // best cost reported by any slave, its grid comes later with the job result
+    int globalCost = this->bestCost;
+
+    // a sub-master is a single slave for rank 0, every batch it got is answered once the whole group is idle
+    int receivedBatches = 0;
+
+    // rank 0 knows which jobs every unanswered batch holds, they stay open in the checkpoint until it is answered
+    bool isTracking = this->checkpoint != nullptr && master == MPI_COMM_NULL;
+    queue<int> queuedJobs;
+    vector<deque<vector<int>>> batchJobs(numProcesses);
+    if (isTracking) {
+        for (int i = 0; i < (int) q.size(); i++) {
+            queuedJobs.push(this->checkpoint->addJob(q.front()));
+            q.push(q.front());
+            q.pop();
+        }
+        this->checkpoint->start();
+    }
+
+    vector<int> message;
+    MPI_Status mpiStatus;
+    while (true) {
+
+        // idle slaves are served first, then the ones that would run dry after their current batch
+        int batchSize = max(1, min(maxBatchJobs, (int) q.size() / (numSlaves * PREFETCHED_BATCHES)));
+        for (int sent = 0; sent < PREFETCHED_BATCHES; sent++) {
+            for (int i = 1; i < numProcesses && !q.empty(); i++) {
+                if (sentBatches[i] == sent) {
+                    if (isTracking) {
+                        batchJobs[i].push_back(vector<int>());
+                        for (int j = 0; j < batchSize && !queuedJobs.empty(); j++) {
+                            batchJobs[i].back().push_back(queuedJobs.front());
+                            queuedJobs.pop();
+                        }
+                    }
+                    this->sendBatch(q, slaves, i, batchSize);
+                    sentBatches[i]++;
+                }
+            }
+        }
+
+        int workingSlaves = 0;
+        bool isAnyIdle = false;
+        for (int i = 1; i < numProcesses; i++) {
+            if (sentBatches[i] > 0) {
+                workingSlaves++;
+            } else {
+                isAnyIdle = true;
+            }
+        }
+
+        if (master == MPI_COMM_NULL) {
+            if (workingSlaves == 0) {
+                break;
+            }
+        } else if (workingSlaves == 0 && q.empty() && receivedBatches > 0) {
+            vector<int> groupResult = resultSerialization(this->buildSolution());
+            for (; receivedBatches > 0; receivedBatches--) {
+                MPI_Send(groupResult.data(), groupResult.size(), MPI_INT, 0, TAG_DONE, master);
+            }
+            this->isDonationWanted = false;
+        }
+
+        // rank 0 asked this group for a subtree, a job nobody started yet goes first
+        if (this->isDonationWanted && !q.empty()) {
+            MPI_Send(q.front().data(), q.front().size(), MPI_INT, 0, TAG_DONATE, master);
+            q.pop();
+            this->isDonationWanted = false;
+        }
+
+        // queue ran dry while some slaves are idle, every busy slave is asked to donate a subtree
+        if (isAnyIdle || this->isDonationWanted) {
+            int idleCount = numSlaves - workingSlaves;
+            for (int i = 1; i < numProcesses; i++) {
+                if (sentBatches[i] > 0 && !isAskedToSplit[i]) {
+                    MPI_Send(&idleCount, 1, MPI_INT, i, TAG_SPLIT, slaves);
+                    isAskedToSplit[i] = true;
+                }
+            }
+        }
+
+        // a sub-master listens to rank 0 and to its group, so it cannot block on either of them
+        int isReceived = 0;
+        if (master != MPI_COMM_NULL) {
+            MPI_Iprobe(0, MPI_ANY_TAG, master, &isReceived, &mpiStatus);
+        }
+
+        if (isReceived) {
+            this->receiveMessage(master, mpiStatus, message);
+
+            if (mpiStatus.MPI_TAG == TAG_FINISHED) {
+                break;
+            }
+
+            if (mpiStatus.MPI_TAG == TAG_JOB) {
+                // jobs only pass through, they stay serialized until a slave gets them
+                int counter = 1;
+                for (int i = 0; i < message[0]; i++) {
+                    int jobSize = message[counter];
+                    q.push(vector<int>(message.begin() + counter + 1, message.begin() + counter + 1 + jobSize));
+                    counter += jobSize + 1;
+                }
+                receivedBatches++;
+            } else if (mpiStatus.MPI_TAG == TAG_BOUND) {
+                if (message[0] > globalCost) {
+                    globalCost = message[0];
+                    for (int i = 1; i < numProcesses; i++) {
+                        MPI_Send(&globalCost, 1, MPI_INT, i, TAG_BOUND, slaves);
+                    }
+                }
+            } else if (mpiStatus.MPI_TAG == TAG_SPLIT && receivedBatches > 0) {
+                this->isDonationWanted = true;
+            }
+            continue;
+        }
+
+        // every message comes in one piece, its size is known from the probe
+        if (master == MPI_COMM_NULL) {
+            MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, slaves, &mpiStatus);
+        } else {
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, slaves, &isReceived, &mpiStatus);
+            if (!isReceived) {
+                this_thread::yield();
+                continue;
+            }
+        }
+
+        int slave = mpiStatus.MPI_SOURCE;
+        this->receiveMessage(slaves, mpiStatus, message);
+
+        if (mpiStatus.MPI_TAG == TAG_BOUND) {
+            if (message[0] > globalCost) {
+                globalCost = message[0];
+                for (int i = 1; i < numProcesses; i++) {
+                    if (i != slave) {
+                        MPI_Send(&globalCost, 1, MPI_INT, i, TAG_BOUND, slaves);
+                    }
+                }
+                // only the improvement goes up, rank 0 forwards it to the other groups
+                if (master != MPI_COMM_NULL) {
+                    MPI_Send(&globalCost, 1, MPI_INT, 0, TAG_BOUND, master);
+                }
+            }
+            continue;
+        }
+
+        if (mpiStatus.MPI_TAG == TAG_DONATE) {
+            if (this->isDonationWanted) {
+                MPI_Send(message.data(), message.size(), MPI_INT, 0, TAG_DONATE, master);
+                this->isDonationWanted = false;
+            } else {
+                q.push(message);
+                // the subtree stays a piece of the job it was split off, like a split inside one rank
+                if (isTracking) {
+                    int job = this->findDonorJob(batchJobs[slave], message);
+                    if (job != -1) {
+                        this->checkpoint->splitJob(job);
+                    } else {
+                        job = this->checkpoint->addJob(message);
+                    }
+                    queuedJobs.push(job);
+                }
+            }
+            isAskedToSplit[slave] = false;
+            continue;
+        }
+
+        if (message[0] > this->bestCost) {
+
+            Grid * resultGrid = this->deserializePlacements(&message[1], message.size() - 1);
+
+            cout << "Found better Grid." << endl;
+            cout << *resultGrid;
+
+            this->offerSolution(resultGrid);
+            delete resultGrid;
+        }
+
+        if (isTracking) {
+            for (int job : batchJobs[slave].front()) {
+                this->checkpoint->finishJob(job);
+            }
+            batchJobs[slave].pop_front();
+        }
+
+        sentBatches[slave]--;
+        if (sentBatches[slave] == 0) {
+            isAskedToSplit[slave] = false;
+        }
+    }
+
+    // Inform about finish
+    int workingSlaves = 0;
+    for (int i = 1; i < numProcesses; i++) {
+        MPI_Send(&workingSlaves, 1, MPI_INT, i, TAG_FINISHED, slaves);
+    }
+}
+
+int Solver::findDonorJob(deque<vector<int>> & batches, vector<int> & subtree) {
+
+    int rows = this->problem->getRowSize();
+
+    // the subtree repeats the placements of its job and adds only blocks from the cursor of the job on
+    for (auto & batch : batches) {
+        for (int job : batch) {
+            vector<int> & data = this->checkpoint->getJob(job);
+            if (subtree.size() < data.size() || !equal(data.begin() + 2, data.end(), subtree.begin() + 2)) {
+                continue;
+            }
+
+            int cursor = data[1] * rows + data[0];
+            bool isInside = true;
+            for (int i = data.size(); i < (int) subtree.size() && isInside; i++) {
+                int x = subtree[i] >> 16;
+                int y = (subtree[i] >> 3) & 0x1FFF;
+                isInside = y * rows + x >= cursor;
+            }
+
+            // jobs are disjoint subtrees, so only one of them can hold it
+            if (isInside) {
+                return job;
+            }
+        }
+    }
+
+    return -1;
+}
+
+void Solver::receiveMessage(MPI_Comm comm, MPI_Status & status, vector<int> & message) {
+
+    int messageSize;
+    MPI_Get_count(&status, MPI_INT, &messageSize);
+    message.resize(messageSize);
+    MPI_Recv(&message[0], messageSize, MPI_INT, status.MPI_SOURCE, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
+}
+
+void Solver::resumeIncumbent() {
+
+    if (this->checkpoint == nullptr || !this->checkpoint->isResumed()) {
+        return;
+    }
+
+    // the grid is rebuilt from its placements, so the cost cannot disagree with the layout
+    vector<int> & placements = this->checkpoint->getPlacements();
+    Grid * grid = this->deserializePlacements(placements.data(), placements.size());
+    this->offerSolution(grid);
+    delete grid;
+}
+
+vector<SearchNode> Solver::expandFrontier(Grid * grid, int minNodes) {
+
+    vector<SearchNode> frontier;
+
+    // a resumed search starts from the jobs its checkpoint left open, none of them when it had finished
+    if (this->checkpoint != nullptr && this->checkpoint->isResumed()) {
+        for (auto & job : this->checkpoint->getLoadedJobs()) {
+            pair<Grid*, Point*> jobState = jobDeserialization(job.data(), job.size());
+            frontier.push_back(SearchNode{jobState.first, *jobState.second, 0});
+            delete jobState.second;
+        }
+        delete grid;
+    } else {
+        frontier.push_back(SearchNode{grid, Point(0, 0), 0});
+    }
+
+    // level by level, so all states are about the same size
+    while (!frontier.empty() && (int) frontier.size() < minNodes) {
+
+        vector<SearchNode> nextLevel;
+        for (auto & node : frontier) {
+            this->expandNode(node, nextLevel);
+        }
+        frontier.swap(nextLevel);
+    }
+
+    return frontier;
+}
+
+void Solver::sendBatch(queue<vector<int>> & q, MPI_Comm slaves, int slave, int jobCount) {
+
+    vector<int> batch;
+    batch.push_back(0);
+
+    while (batch[0] < jobCount && !q.empty()) {
+        vector<int> & serializedJob = q.front();
+        batch.push_back(serializedJob.size());
+        batch.insert(batch.end(), serializedJob.begin(), serializedJob.end());
+        batch[0]++;
+        q.pop();
+    }
+
+    MPI_Send(batch.data(), batch.size(), MPI_INT, slave, TAG_JOB, slaves);
+}
+
+int Solver::maxBatchSize() {
+
+    // job count, then every job with its size in front, a block covers at least one square
+    int maxJobSize = 2 + this->problem->getRowSize() * this->problem->getColumnSize();
+    return 1 + JOBS_PER_BATCH * (1 + maxJobSize);
+}
+
+void Solver::communicate(WorkStealingExecutor & executor) {
+
+    // the next batch is received in the background while the current one is searched
+    vector<int> nextBatch;
+    nextBatch.resize(this->maxBatchSize());
+
+    MPI_Request nextRequest;
+    MPI_Irecv(&nextBatch[0], nextBatch.size(), MPI_INT, 0, TAG_JOB, this->masterComm, &nextRequest);
+
+    int threads = omp_get_num_threads();
+    bool isSearching = false;
+
+    while (true) {
+
+        // every job of the batch is done, the master gets the best grid of this slave
+        if (isSearching && executor.getPendingNodes() == 0) {
+            // subtrees split off during the batch must reach the master before its result
+            this->donateSubtrees(executor);
+
+            vector<int> jobResultSerialized = resultSerialization(this->buildSolution());
+
+            cout << "Slave finished computation." << endl;
+
+            MPI_Send(jobResultSerialized.data(), jobResultSerialized.size(), MPI_INT, 0, TAG_DONE, this->masterComm);
+            isSearching = false;
+        }
+
+        if (!isSearching) {
+            int isReceived;
+            MPI_Status batchStatus;
+            MPI_Test(&nextRequest, &isReceived, &batchStatus);
+
+            if (isReceived) {
+                this->pushBatch(executor, nextBatch);
+                MPI_Irecv(&nextBatch[0], nextBatch.size(), MPI_INT, 0, TAG_JOB, this->masterComm, &nextRequest);
+                isSearching = true;
+            }
+        }
+
+        if (!this->pollMaster(executor)) {
+            MPI_Cancel(&nextRequest);
+            MPI_Wait(&nextRequest, MPI_STATUS_IGNORE);
+            executor.close();
+            return;
+        }
+
+        if (!isSearching) {
+            // the batch was finished before the split request came
+            this->isDonationWanted = false;
+            this->isSplitAsked = false;
+        }
+
+        // without a team thread 0 searches itself and polls the master from inside the search
+        if (threads == 1) {
+            SearchNode node;
+            if (executor.tryPop(0, node)) {
+                this->dfsRecursive(node.grid, &node.cord, node.depth);
+                delete node.grid;
+                executor.finish();
+                continue;
+            }
+        }
+
+        this_thread::yield();
+    }
+}
+
+void Solver::pushBatch(WorkStealingExecutor & executor, vector<int> & batch) {
+
+    // job count followed by the size and the data of every job, all of them wait in the queue of thread 0
+    int counter = 1;
+    for (int i = 0; i < batch[0]; i++) {
+        int jobSize = batch[counter];
+        pair<Grid*, Point*> jobState = jobDeserialization(&batch[counter + 1], jobSize);
+        counter += jobSize + 1;
+
+        executor.push(0, jobState.first, *jobState.second, 0, 0);
+        delete jobState.second;
+    }
+}
+
+bool Solver::pollMaster(WorkStealingExecutor & executor) {
+
+    // only control tags are probed, a prefetched batch may wait behind the posted receive and must stay for it
+    const int controlTags[] = {TAG_BOUND, TAG_SPLIT, TAG_FINISHED};
+    for (int tag : controlTags) {
+
+        int isControl;
+        MPI_Iprobe(0, tag, this->masterComm, &isControl, MPI_STATUS_IGNORE);
+
+        while (isControl) {
+
+            int value;
+            MPI_Recv(&value, 1, MPI_INT, 0, tag, this->masterComm, MPI_STATUS_IGNORE);
+
+            if (tag == TAG_FINISHED) {
+                return false;
+            } else if (tag == TAG_BOUND) {
+                this->raiseBestCost(value);
+            } else if (tag == TAG_SPLIT) {
+                this->isDonationWanted = true;
+                this->isSplitAsked = true;
+            }
 
-    cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
-    cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
-    cout << "C: " << solutionGrid->getCost() << endl;
+            MPI_Iprobe(0, tag, this->masterComm, &isControl, MPI_STATUS_IGNORE);
+        }
+    }
 
-    return solutionGrid;
-}
+    this->shareBestCost();
+    this->donateSubtrees(executor);
 
-Grid * Solver::solveDistributed() {
-    Grid * grid = new Grid(problem);
+    return true;
+}
 
-    this->solutionGrid = new Grid(grid, problem);
+void Solver::donateSubtrees(WorkStealingExecutor & executor) {
 
-    MPI_Init(nullptr, nullptr);
-    this->solveMPI(grid);
+    vector<SearchNode> nodes;
+    # pragma omp critical (donation)
+    {
+        nodes.swap(this->donatedNodes);
+    };
 
-    cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
-    cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
-    cout << "C: " << solutionGrid->getCost() << endl;
+    for (auto & node : nodes) {
+        vector<int> serializedJob = jobSerialization(node.grid, &node.cord);
+        MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, 0, TAG_DONATE, this->masterComm);
+        delete node.grid;
+        this->isDonationWanted = false;
+    }
 
-    return solutionGrid;
-}
+    if (!this->isDonationWanted) {
+        return;
+    }
 
+    // a job nobody started yet goes first, but only while this slave keeps some other work
+    SearchNode node;
+    if (executor.getPendingNodes() > 1 && executor.tryPop(0, node)) {
+        vector<int> serializedJob = jobSerialization(node.grid, &node.cord);
+        MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, 0, TAG_DONATE, this->masterComm);
+        delete node.grid;
+        executor.finish();
+
+        this->isDonationWanted = false;
+        this->isSplitAsked = false;
+        return;
+    }
 
-Solver::Solver(CoverageProblem * problem) {
-    this->problem = problem;
-    this->solutionGrid = nullptr;
+    // the searching threads split one off
+    this->isSplitAsked = true;
 }
 
-Grid * Solver::solveMPI(Grid * grid) {
+bool Solver::splitForMaster(Grid * grid, Point * cord, int depth) {
 
-    // initial position
-    Point * cord = new Point(0, 0);
-    if (grid->getGridValue(cord->getX(), cord->getY()) == BLOCKED) {
-        cord = this->nextCord(cord, grid);
+    // thread 0 searches only when it has no team, probing on every node would cost more than the search itself
+    if (omp_get_thread_num() == 0) {
+        static thread_local int visitedNodes = 0;
+        if (++visitedNodes % DONATION_POLL_INTERVAL == 0) {
+            this->pollMaster(*this->executor);
+        }
     }
 
-    queue<pair<Grid*, Point*>> q;
-
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // small subtrees are searched here, a bigger one comes up once the search returns higher
+    if (!this->isSplitAsked.load(memory_order_relaxed) || grid->countUnsolvedSquares(cord) < MIN_DONATED_SQUARES) {
+        return false;
+    }
 
-    if (rank == 0) {
+    bool isAsked = true;
+    if (!this->isSplitAsked.compare_exchange_strong(isAsked, false)) {
+        return false;
+    }
 
-        int numProcesses;
-        MPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+    // kept apart from the executor, so that no other thread of the team steals it
+    Grid * donatedGrid = new Grid(grid, problem);
+    # pragma omp critical (donation)
+    {
+        this->donatedNodes.push_back(SearchNode{donatedGrid, *cord, depth});
+    };
 
-        // Run BFS and feed the queue with first jobs
-        q.push(make_pair(grid, cord));
+    return true;
+}
 
-        // generate numJobs and store it in queue
-        while (q.size() < numProcesses) {
+void Solver::shareBestCost() {
 
-            auto stateJob = q.front();
-            q.pop();
+    // own improvement goes to the master, it forwards it to all other slaves
+    int best = this->bestCost.load();
+    if (best > this->sharedCost) {
+        MPI_Send(&best, 1, MPI_INT, 0, TAG_BOUND, this->masterComm);
+        this->sharedCost = best;
+    }
+}
 
-            // generate state jobs, it stores is in queue
-            auto stateJobs = this->bfs(stateJob.first, stateJob.second, 1);
-            delete stateJob.first;
-            delete stateJob.second;
+void Solver::raiseBestCost(int cost) {
 
-            // iterate over queue and add job states to the main job queue
-            while (!stateJobs.empty()) {
-                q.push(stateJobs.front());
+    // only prunes harder, the grid with this cost is kept by the rank that found it
+    int best = this->bestCost.load();
+    while (cost > best && !this->bestCost.compare_exchange_weak(best, cost)) {
+    }
 
-                stateJobs.pop();
-            }
-        }
+    if (cost > this->sharedCost) {
+        this->sharedCost = cost;
+    }
+}
 
-        // distribute jobs to all slaves
-        for (int i = 1; i < numProcesses; i++) {
-            pair<Grid*, Point*> stateJob = q.front();
-            q.pop();
+vector<int> Solver::jobSerialization(Grid * grid, Point * point) {
 
-            vector<int> serializedJob = jobSerialization(stateJob.first, stateJob.second);
-            delete stateJob.first;
-            delete stateJob.second;
+    // cursor followed by the placements from the root
+    vector<int> serializedJob;
+    serializedJob.reserve(2 + grid->getPlacementCount());
 
-            // send index init workers?
-            int jobSize = serializedJob.size();
-            MPI_Send(&jobSize, 1, MPI_INT, i, TAG_INIT_SIZE, MPI_COMM_WORLD); // TAG_INIT - 0
+    serializedJob.push_back(point->getX());
+    serializedJob.push_back(point->getY());
+    this->serializePlacements(grid, serializedJob);
 
-            MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, i, TAG_JOB, MPI_COMM_WORLD); // TAG_WORK - 1
-        }
+    return serializedJob;
+}
 
-        MPI_Status mpiStatus;
-        int workingSlaves = numProcesses - 1;
-        while (workingSlaves > 0) {
+pair<Grid*, Point*> Solver::jobDeserialization(const int * serializedJob, int jobSize) {
 
-            int jobResultSize;
-            MPI_Recv(&jobResultSize, 1, MPI_INT, MPI_ANY_SOURCE, TAG_INIT_SIZE, MPI_COMM_WORLD, &mpiStatus);
+    Point * cord = new Point(serializedJob[0], serializedJob[1]);
+    Grid * grid = this->deserializePlacements(serializedJob + 2, jobSize - 2);
 
-            vector<int> jobResult;
-            jobResult.resize(jobResultSize);
-            MPI_Recv(&jobResult[0], jobResultSize, MPI_INT, mpiStatus.MPI_SOURCE, TAG_DONE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            pair<Grid*, Point*> resultJob = jobDeserialization(jobResult);
+    return make_pair(grid, cord);
+}
 
-            if (resultJob.first->getCost() > this->solutionGrid->getCost()) {
+vector<int> Solver::resultSerialization(Grid * grid) {
 
-                cout << "Found better Grid." << endl;
-                cout << *resultJob.first;
+    // cost goes first, so the master rebuilds just the grids that improve its solution
+    vector<int> serializedResult;
+    serializedResult.reserve(1 + grid->getPlacementCount());
 
-                delete this->solutionGrid;
-                this->solutionGrid = new Grid(resultJob.first, this->problem);
-            }
+    serializedResult.push_back(grid->getCost());
+    this->serializePlacements(grid, serializedResult);
 
-            if (!q.empty()) {
-                // send new job from queue
-                pair<Grid*, Point*> stateJob = q.front();
-                q.pop();
+    return serializedResult;
+}
 
-                vector<int> serializedJob = jobSerialization(stateJob.first, stateJob.second);
-                delete stateJob.first;
-                delete stateJob.second;
+void Solver::serializePlacements(Grid * grid, vector<int> & out) {
 
-                int jobSize = serializedJob.size();
-                MPI_Send(&jobSize , 1, MPI_INT, mpiStatus.MPI_SOURCE, TAG_INIT_SIZE, MPI_COMM_WORLD); // TAG_INIT - 0
+    // one int per block, the id tells its type and orientation
+    for (int i = 0; i < grid->getPlacementCount(); i++) {
+        Placement & placement = grid->getPlacement(i);
+        out.push_back((placement.x << 16) | (placement.y << 3) | placement.id);
+    }
+}
 
-                MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, mpiStatus.MPI_SOURCE, TAG_JOB, MPI_COMM_WORLD); // TAG_WORK - 1
-            } else {
-                // Inform about finish
-                MPI_Send(&workingSlaves, 1, MPI_INT, mpiStatus.MPI_SOURCE, TAG_FINISHED, MPI_COMM_WORLD);
-                workingSlaves--;
-            }
-        }
+Grid * Solver::deserializePlacements(const int * placements, int count) {
 
-    } else {
+    Grid * grid = new Grid(this->problem);
 
-        bool endIndicator = false;
-        MPI_Status mpiStatus;
+    for (int i = 0; i < count; i++) {
+        grid->addBlockById(placements[i] >> 16, (placements[i] >> 3) & 0x1FFF, placements[i] & 7);
+    }
 
-        while (!endIndicator) {
+    return grid;
+}
 
-            int jobSize;
-            MPI_Recv(&jobSize, 1, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpiStatus);
 
-            if (mpiStatus.MPI_TAG != TAG_FINISHED) {
-                // MPI_SOURCE should be MASTER!
-                vector<int> job;
-                job.resize(jobSize);
-                MPI_Recv(&job[0], jobSize, MPI_INT, mpiStatus.MPI_SOURCE, TAG_JOB, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                pair<Grid*, Point*> jobState = jobDeserialization(job);
+Grid * Solver::solveLoop(Grid * grid, int statesPerThread) {
 
-                Grid *jobResult;
-                # pragma omp parallel
-                {
-                    # pragma omp single
-                    jobResult = dfsRecursive(jobState.first, jobState.second, 0, 0);
-                }
-                vector<int> jobResultSerialized = jobSerialization(jobResult, jobState.second);
-                //delete jobState.first;
-                //delete jobState.second;
-                //delete jobResult;
+    int threads = omp_get_max_threads();
+    vector<SearchNode> frontier = this->expandFrontier(grid, statesPerThread * threads);
+    this->trackJobs(frontier);
 
-                cout << "Slave finished computation." << endl;
+    // every state is searched sequentially, they only share the incumbent
+    # pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) frontier.size(); i++) {
+        this->dfsRecursive(frontier[i].grid, &frontier[i].cord, frontier[i].depth);
+        delete frontier[i].grid;
 
-                int jobResultSize = jobResultSerialized.size();
-                MPI_Send(&jobResultSize, 1, MPI_INT, mpiStatus.MPI_SOURCE, TAG_INIT_SIZE, MPI_COMM_WORLD);
-                MPI_Send(jobResultSerialized.data(), jobResultSize, MPI_INT, mpiStatus.MPI_SOURCE, TAG_DONE, MPI_COMM_WORLD);
-            } else {
-                endIndicator = true;
-            }
+        if (this->checkpoint != nullptr) {
+            this->checkpoint->finishJob(frontier[i].job);
         }
     }
 
-    MPI_Finalize();
+    if (this->checkpoint != nullptr) {
+        this->checkpoint->stop();
+    }
 
     return this->solutionGrid;
 }
 
-queue<pair<Grid*, Point*>> Solver::bfs(Grid * grid, Point * cord, int depth) {
+void Solver::trackJobs(vector<SearchNode> & frontier) {
 
-    Grid * curGrid = grid;
-    Point * curCord = cord;
+    if (this->checkpoint == nullptr) {
+        return;
+    }
 
-    queue<pair<Grid*, Point*>> q;
+    for (auto & node : frontier) {
+        node.job = this->checkpoint->addJob(jobSerialization(node.grid, &node.cord));
+    }
+    this->checkpoint->start();
+}
 
-    while(q.size() < depth) {
+void Solver::expandNode(SearchNode & node, vector<SearchNode> & children) {
 
-        if (!q.empty()) {
-            pair<Grid*, Point*> state = q.front();
+    Grid * grid = node.grid;
 
-            curGrid = state.first;
-            curCord = this->nextCord(state.second, curGrid);
+    BlockList possibleBlocks = grid->generatePossibleBlocks(&node.cord);
+    if (possibleBlocks.size() == 0) {
 
-            q.pop();
+        // nothing to place here, the same grid moves on to the next square
+        Point next = node.cord;
+        if (this->nextCord(next, grid) &&
+            grid->upperBoundCost(&next) + grid->getCostWithoutPenalty(&next) > this->bestCost.load() &&
+            this->isCanonical(grid, &node.cord, &next)) {
+            children.push_back(SearchNode{grid, next, node.depth + 1});
+        } else {
+            delete grid;
         }
+        return;
+    }
 
-        vector<Block*> possibleBlocks = curGrid->generatePossibleBlocks(curCord);
-        for (auto block : possibleBlocks) {
-
-            if (curGrid->addBlockIfPossible(block)) {
+    for (int i = 0; i < possibleBlocks.size(); i++) {
 
-                Grid *newGrid = new Grid(curGrid, problem);
-                Point *newCord = new Point(curCord->getX(), curCord->getY());
-                newCord = this->nextCord(newCord, newGrid);
+        if (grid->addBlockIfPossible(possibleBlocks[i])) {
 
-                q.push(make_pair(newGrid, newCord));
+            this->offerSolution(grid);
 
-                curGrid->undoBlock(block);
+            Point next = node.cord;
+            if (this->nextCord(next, grid) &&
+                grid->upperBoundCost(&next) + grid->getCostWithoutPenalty(&next) > this->bestCost.load() &&
+                this->isCanonical(grid, &node.cord, &next)) {
+                children.push_back(SearchNode{new Grid(grid, problem), next, node.depth + 1});
             }
 
+            if (possibleBlocks[i].getType() != EMPTY) {
+                grid->undoBlock(possibleBlocks[i]);
+            }
         }
     }
 
-    return q;
-};
-
+    delete grid;
+}
 
-vector<int> Solver::jobSerialization(Grid * grid, Point * point) {
+Grid * Solver::dfsRecursive(Grid * grid, Point * cord, int depth) {
 
-    int rows = this->problem->getRowSize();
-    int columns = this->problem->getColumnSize();
+    if (cord == nullptr) {
+        return this->solutionGrid;
+    }
 
-    vector<int> serializedJob;
+    // the same frontier was searched before and nothing behind it beats the incumbent from this cost
+    uint64_t key = this->transpositionKey(grid, cord);
+    int bound;
+    if (key != 0 && this->transpositions->probe(key, bound) &&
+        grid->getCost() + bound <= this->bestCost.load(memory_order_relaxed)) {
+        return this->solutionGrid;
+    }
+    int splits = splitCount;
 
-    serializedJob.push_back(point->getX());
-    serializedJob.push_back(point->getY());
+    // blocks are placed into and undone from the same grid, it is only copied for a split off subtree
+    BlockList possibleBlocks = grid->generatePossibleBlocks(cord);
+    if (possibleBlocks.size() == 0) {
 
-    serializedJob.push_back(grid->getCost());
+        Point next = *cord;
+        Point * nextCord = this->nextCord(next, grid) ? &next : nullptr;
 
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < columns; j++) {
-            serializedJob.push_back(grid->getGridValue(i, j));
+        int bound = grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord);
+        if (bound > this->bestCost.load(memory_order_relaxed) && this->isCanonical(grid, cord, nextCord)) {
+            this->dfsChild(grid, nextCord, depth + 1, bound);
         }
+
+        return this->solutionGrid;
     }
 
-    return serializedJob;
+    for (int i = 0; i < possibleBlocks.size(); i++) {
 
-}
+        bool isAdded = grid->addBlockIfPossible(possibleBlocks[i]);
 
-pair<Grid*, Point*> Solver::jobDeserialization(vector<int> & serializedJob) {
+        if (isAdded) {
 
-    int rows = this->problem->getRowSize();
-    int columns = this->problem->getColumnSize();
+            this->offerSolution(grid);
 
-    Point * cord = new Point(serializedJob[0], serializedJob[1]);
-    Grid * grid = new Grid(this->problem);
-    grid->updateCost(serializedJob[2]);
+            Point next = *cord;
+            Point * nextCord = this->nextCord(next, grid) ? &next : nullptr;
+
+            int bound = grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord);
+            if (bound > this->bestCost.load(memory_order_relaxed) && this->isCanonical(grid, cord, nextCord)) {
+                this->dfsChild(grid, nextCord, depth + 1, bound);
+            }
 
-    int counter = 3;
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < columns; j++) {
-            grid->updateGridValue(i, j, serializedJob[counter]);
-            counter++;
+            if (possibleBlocks[i].getType() != EMPTY) {
+                grid->undoBlock(possibleBlocks[i]);
+            }
         }
     }
 
-    return make_pair(grid, cord);
-}
+    this->storeTransposition(grid, cord, key, splits);
 
+    return this->solutionGrid;
+}
 
-Grid * Solver::solveLoop(Grid * grid, int depth) {
+void Solver::dfsChild(Grid * grid, Point * cord, int depth, int bound) {
 
-    queue<pair<Grid*, Point*>> q;
+    if (cord == nullptr) {
+        return;
+    }
 
-    // initial position
-    Point * cord = new Point(0, 0);
-    if (grid->getGridValue(cord->getX(), cord->getY()) == BLOCKED) {
-        cord = this->nextCord(cord, grid);
+    if (this->isDonating && this->splitForMaster(grid, cord, depth)) {
+        splitCount++;
+        return;
     }
 
-    Grid * curGrid = grid;
-    Point * curCord = cord;
-    while(q.size() < depth) {
+    if (!this->isWorthSplitting(grid, cord, bound)) {
+        this->dfsRecursive(grid, cord, depth);
+        return;
+    }
 
-        if (!q.empty()) {
-            pair<Grid*, Point*> state = q.front();
+    splitCount++;
 
-            curGrid = state.first;
-            curCord = this->nextCord(state.second, curGrid);
+    // the job stays open until the split off piece is searched too
+    if (this->checkpoint != nullptr) {
+        this->checkpoint->splitJob(activeJob);
+    }
+    this->executor->push(omp_get_thread_num(), new Grid(grid, problem), *cord, depth, activeJob);
+}
 
-            q.pop();
-        }
+bool Solver::isCanonical(Grid * grid, Point * cord, Point * next) {
 
-        vector<Block*> possibleBlocks = curGrid->generatePossibleBlocks(curCord);
-        for (auto block : possibleBlocks) {
+    // checked once a column is finished, only the first columns are worth the scan
+    vector<int> & symmetries = this->problem->getSymmetries();
+    if (symmetries.empty() || next == nullptr || next->getY() == cord->getY() || next->getY() > SYMMETRY_COLUMNS) {
+        return true;
+    }
 
-            if (curGrid->addBlockIfPossible(block)) {
+    // squares before the cursor are final, every symmetric layout keeps the same cost
+    int rows = this->problem->getRowSize();
+    int decided = next->getY() * rows + next->getX();
 
-                Grid *newGrid = new Grid(curGrid, problem);
-                Point *newCord = new Point(0, 0);
+    for (int symmetry : symmetries) {
+        bool isTransposing = this->problem->isTransposing(symmetry);
 
-                cout << *newGrid << endl;
+        // the layout is searched only if it is column by column no bigger than its image
+        for (int k = 0; k < decided; k++) {
+            int x = k % rows;
+            int y = k / rows;
 
-                q.push(make_pair(newGrid, newCord));
+            Point image = this->problem->mapSymmetric(symmetry, x, y);
+            if (image.getY() * rows + image.getX() >= decided) {
+                break;
+            }
 
-                curGrid->undoBlock(block);
+            int value = grid->getGridValue(x, y);
+            int imageValue = grid->getGridValue(image.getX(), image.getY());
+            if (isTransposing && imageValue > 0) {
+                // ids go vertical, horizontal for I1 and then for I2
+                imageValue = imageValue % 2 == 1 ? imageValue + 1 : imageValue - 1;
             }
 
+            if (value > imageValue) {
+                return false;
+            }
+            if (value < imageValue) {
+                break;
+            }
         }
     }
 
-    //#pragma omp parallel for //default(shared)
-    for (int i = 0; i < q.size(); i++) {
+    return true;
+}
 
-        pair<Grid*, Point*> jobState = q.front();
-        q.pop();
+uint64_t Solver::transpositionKey(Grid * grid, Point * cord) {
 
-        dfsRecursive(jobState.first, jobState.second, 0, 0);
+    // symmetric layouts are pruned depending on the columns before the frontier, their subtrees are not comparable
+    if (this->transpositions == nullptr ||
+        (!this->problem->getSymmetries().empty() && cord->getY() < SYMMETRY_COLUMNS)) {
+        return 0;
     }
 
-    return this->solutionGrid;
+    // small subtrees are searched faster than looked up
+    int rows = this->problem->getRowSize();
+    if ((this->problem->getColumnSize() - cord->getY()) * rows - cord->getX() < TRANSPOSITION_MIN_SQUARES) {
+        return 0;
+    }
+
+    return this->transpositions->hash(grid, cord);
 }
 
-Grid * Solver::dfsRecursive(Grid * grid, Point * cord, int depth, const int depthThreshold) {
+void Solver::storeTransposition(Grid * grid, Point * cord, uint64_t key, int splits) {
 
-    if (cord == nullptr) {
-        return this->solutionGrid;
+    // a piece split off is still searched elsewhere, the incumbent does not cover it yet
+    if (key == 0 || splitCount != splits) {
+        return;
     }
 
-    vector<Block*> possibleBlocks = grid->generatePossibleBlocks(cord);
-    if (possibleBlocks.size() == 0) {
+    // no layout behind the frontier beats the incumbent, it bounds what any other way to the frontier can add
+    int rows = this->problem->getRowSize();
+    int squares = (this->problem->getColumnSize() - cord->getY()) * rows - cord->getX();
+    this->transpositions->store(key, this->bestCost.load(memory_order_relaxed) - grid->getCost(), squares);
+}
 
-        Point * nextCord = this->nextCord(cord, grid);
+bool Solver::isWorthSplitting(Grid * grid, Point * cord, int bound) {
 
-        if (grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord) > this->solutionGrid->getCost()) {
-            Grid * newGrid = new Grid(grid, problem);
-            # pragma omp task if (depth < depthThreshold)
-            {
-                this->dfsRecursive(newGrid, nextCord, ++depth, depthThreshold);
-            };
-        }
+    int threads = omp_get_num_threads();
+    if (threads == 1 || this->executor == nullptr) {
+        return false;
+    }
 
-        delete cord;
+    // split only when the other threads run out of work
+    if (!this->executor->isHungry(omp_get_thread_num())) {
+        return false;
+    }
 
-        return this->solutionGrid;
+    // a bound barely above the incumbent gets pruned within a few blocks
+    int blockCost = max(this->problem->getI1Cost(), this->problem->getI2Cost());
+    if (bound - this->bestCost.load(memory_order_relaxed) <= blockCost) {
+        return false;
     }
 
-    for (int i = 0; i < possibleBlocks.size(); i++) {
+    int cutoff = this->splitCutoff.load(memory_order_relaxed);
+    if (grid->countUnsolvedSquares(cord) >= cutoff) {
+        return true;
+    }
 
-        bool isAdded = grid->addBlockIfPossible(possibleBlocks[i]);
+    // nothing big enough is left while threads are starving, accept smaller subtrees from now on
+    if (cutoff > MIN_SPLIT_SQUARES) {
+        this->splitCutoff.store(cutoff - 1, memory_order_relaxed);
+    }
 
-        if (isAdded) {
+    return false;
+}
 
-            #pragma omp critical
+void Solver::offerSolution(Grid * grid) {
+
+    int cost = grid->getCost();
+    int best = this->bestCost.load();
+
+    // pruning only reads the atomic cost, placements are copied just for a real improvement
+    while (cost > best) {
+        if (this->bestCost.compare_exchange_weak(best, cost)) {
+            #pragma omp critical (solution)
             {
-                if (grid->getCost() > this->solutionGrid->getCost()) {
-                    delete this->solutionGrid;
-                    this->solutionGrid = new Grid(grid, this->problem);
+                if (cost > this->solutionCost) {
+                    grid->copyPlacements(this->bestPlacements);
+                    this->solutionCost = cost;
+
+                    if (this->checkpoint != nullptr) {
+                        vector<int> placements;
+                        this->serializePlacements(grid, placements);
+                        this->checkpoint->setIncumbent(cost, placements);
+                    }
                 }
             };
+            return;
+        }
+    }
+}
 
-            Point *nextCord = this->nextCord(cord, grid);
-
-            if (grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord) > this->solutionGrid->getCost()) {
-                Grid * newGrid = new Grid(grid, problem);
-                # pragma omp task if (depth < depthThreshold)
-                {
-                    this->dfsRecursive(newGrid, nextCord, ++depth, depthThreshold);
-                };
-            }
+Grid * Solver::buildSolution() {
 
-            if (possibleBlocks[i]->getType() != EMPTY) {
-                grid->undoBlock(possibleBlocks[i]);
-            }
-        }
+    if (this->solutionCost <= this->solutionGrid->getCost()) {
+        return this->solutionGrid;
     }
 
-    delete cord;
-    delete grid;
+    delete this->solutionGrid;
+    this->solutionGrid = new Grid(this->problem);
+    for (auto & placement : this->bestPlacements) {
+        this->solutionGrid->addPlacement(placement);
+    }
 
     return this->solutionGrid;
 }
 
 Point * Solver::nextCord(Point * cord, Grid * grid) {
 
+    Point next = *cord;
+    if (!this->nextCord(next, grid)) {
+        return nullptr;
+    }
+
+    return new Point(next);
+}
+
+bool Solver::nextCord(Point & cord, Grid * grid) {
+
     int rows = this->problem->getRowSize();
     int columns = this->problem->getColumnSize();
 
-    int x = cord->getX();
-    int y = cord->getY();
-    //delete cord;
+    int x = cord.getX();
+    int y = cord.getY();
 
     do {
         if (x + 1 < rows) {
@@ -1116,53 +3564,239 @@ Point * Solver::nextCord(Point * cord, Grid * grid) {
             y++;
             continue;
         }
-    } while (grid->getGridValue(x,y) != 0 && !(x + 1 == rows && y + 1 == columns));
+    } while (!grid->isEmpty(x, y) && !(x + 1 == rows && y + 1 == columns));
 
     if (x + 1 == rows && y + 1 == columns) {
-        return nullptr;
+        return false;
     }
 
-    return new Point(x, y);
+    cord = Point(x, y);
+
+    return true;
 }
 
 
 //______________________________________________________________
 
+// problem files of a batch, every regular file of a directory or every line of a manifest
+vector<string> listProblemFiles(const string & path) {
+
+    vector<string> files;
+
+    struct stat pathStat;
+    if (stat(path.c_str(), &pathStat) == -1) {
+        throw runtime_error(path + ": " + strerror(errno));
+    }
+
+    if (S_ISDIR(pathStat.st_mode)) {
+        DIR * dir = opendir(path.c_str());
+        if (dir == nullptr) {
+            throw runtime_error(path + ": " + strerror(errno));
+        }
+
+        struct dirent * entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            string file = path + "/" + entry->d_name;
+            struct stat fileStat;
+            if (entry->d_name[0] != '.' && stat(file.c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+                files.push_back(file);
+            }
+        }
+        closedir(dir);
+
+        sort(files.begin(), files.end());
+        return files;
+    }
+
+    // one path per line, relative ones are taken from the directory of the manifest
+    string base;
+    size_t slash = path.rfind('/');
+    if (slash != string::npos) {
+        base = path.substr(0, slash + 1);
+    }
+
+    ifstream manifest(path);
+    string line;
+    while (getline(manifest, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        files.push_back(line[0] == '/' ? line : base + line);
+    }
+
+    return files;
+}
+
+string jsonString(const string & value) {
+
+    ostringstream out;
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char) c < 0x20) {
+            out << "\\u" << hex << setw(4) << setfill('0') << (int) c << dec;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+
+    return out.str();
+}
+
+string batchResult(const string & file, CoverageProblem * problem, Grid * solution, const char * solver, double seconds) {
+
+    ostringstream out;
+    out << "{\"file\":" << jsonString(file)
+        << ",\"rows\":" << problem->getRowSize()
+        << ",\"columns\":" << problem->getColumnSize()
+        << ",\"cost\":" << solution->getCost()
+        << ",\"solver\":\"" << solver << "\""
+        << ",\"seconds\":" << seconds << "}";
+
+    return out.str();
+}
+
+void printBatchLine(const string & line) {
+
+    // whole lines only, results of concurrent problems must not interleave
+    #pragma omp critical (output)
+    {
+        cout << line << endl;
+    };
+}
+
+// solves every problem of a directory or manifest and prints one json line per problem as soon as it is done
+int solveBatch(const char * path) {
+
+    vector<string> files;
+    try {
+        files = listProblemFiles(path);
+    } catch (runtime_error & e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+
+    vector<CoverageProblem *> problems(files.size(), nullptr);
+    vector<int> largeProblems;
+    vector<int> smallProblems;
+
+    for (int i = 0; i < (int) files.size(); i++) {
+        problems[i] = new CoverageProblem();
+        try {
+            problems[i]->load(files[i].c_str());
+        } catch (runtime_error & e) {
+            printBatchLine("{\"file\":" + jsonString(files[i]) + ",\"error\":" + jsonString(e.what()) + "}");
+            delete problems[i];
+            problems[i] = nullptr;
+            continue;
+        }
+
+        int freeSquares = problems[i]->getRowSize() * problems[i]->getColumnSize() - problems[i]->getForbiddenPoints().size();
+        if (freeSquares <= BATCH_SMALL_SQUARES || ProfileSolver(problems[i]).isSolvable()) {
+            smallProblems.push_back(i);
+        } else {
+            largeProblems.push_back(i);
+        }
+    }
+
+    // small and narrow problems take less than starting a team, each one is solved by one thread
+    # pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) smallProblems.size(); i++) {
+        int index = smallProblems[i];
+
+        auto start = chrono::high_resolution_clock::now();
+        Solver solver(problems[index]);
+        solver.setVerbose(false);
+        bool isProfile = solver.isProfileSolvable();
+        Grid * solution = isProfile ? solver.solveProfile() : solver.solveSequence();
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+
+        printBatchLine(batchResult(files[index], problems[index], solution, isProfile ? "profile" : "sequence", elapsed.count()));
+    }
+
+    // the big ones get all threads, one after another
+    for (int index : largeProblems) {
+
+        auto start = chrono::high_resolution_clock::now();
+        Solver solver(problems[index]);
+        solver.setVerbose(false);
+        Grid * solution = solver.solveTaskParallel();
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+
+        printBatchLine(batchResult(files[index], problems[index], solution, "task-parallel", elapsed.count()));
+    }
+
+    for (auto problem : problems) {
+        delete problem;
+    }
+
+    return 0;
+}
+
 int main(int argc,  char **argv) {
 
-    if(argc != 3) {
+    if(argc < 3) {
         cout << "Missing input file or solver type" << endl;
         return 1;
     }
 
-    cout << "Processing file: " << argv[1] << endl;
+    int solverType = strtol(argv[2], NULL, 10);
+    int depthThreshold = argc > 3 ? strtol(argv[3], NULL, 10) : THRESHOLD;
 
-    ifstream fs(argv[1], ios::in);
+    // the input is a directory or a manifest of problem files, only the results are printed
+    if (solverType == SOLVER_BATCH) {
+        return solveBatch(argv[1]);
+    }
 
-    int solverType = strtol(argv[2], NULL, 10);
-    int depthThreshold = strtol(argv[3], NULL, 10);
+    cout << "Processing file: " << argv[1] << endl;
 
     CoverageProblem * problem = new CoverageProblem();
-    fs >> *problem;
+    try {
+        problem->load(argv[1]);
+    } catch (runtime_error & e) {
+        cout << e.what() << endl;
+        return 1;
+    }
 
     cout << *problem;
 
     //--------TEST---------
     Grid * grid = new Grid(problem);
 
-    cout << grid->addBlockIfPossible(new Block(new Point(6,4), TYPE_1, HORIZONTAL, TYPE_1 + HORIZONTAL)) << endl;
+    Block testBlock(Point(6,4), TYPE_1, HORIZONTAL, TYPE_1 + HORIZONTAL);
+    cout << grid->addBlockIfPossible(testBlock) << endl;
 
     cout << *grid;
     //--------TEST---------
 
     Solver * solver = new Solver(problem);
 
+    // an existing checkpoint is resumed, either way it is rewritten while the search runs
+    Checkpoint * checkpoint = nullptr;
+    if (argc > 4) {
+        checkpoint = new Checkpoint(argv[4], problem);
+        try {
+            if (checkpoint->load()) {
+                cout << "Resuming from checkpoint: " << argv[4] << endl;
+            }
+        } catch (runtime_error & e) {
+            cout << e.what() << endl;
+            return 1;
+        }
+        solver->setCheckpoint(checkpoint);
+    }
+
     auto start = chrono::high_resolution_clock::now();
 
     if (solverType == 0) {
-        cout << *solver->solveSequence();
+        // narrow grids are solved exactly profile by profile
+        cout << *(solver->isProfileSolvable() ? solver->solveProfile() : solver->solveSequence());
     } else if (solverType == 1) {
-        cout << *solver->solveTaskParallel(depthThreshold);
+        cout << *solver->solveTaskParallel();
     } else if (solverType == 2) {
         cout << *solver->solveDataParallel(depthThreshold);
     } else if (solverType == 3) {
@@ -1175,5 +3809,7 @@ int main(int argc,  char **argv) {
     chrono::duration<double, std::ratio<1>> elapsed = end-start;
     cout << "Program duration: " << elapsed.count() << " seconds" << std::endl;
 
+    delete checkpoint;
+
     return 0;
 }
\ No newline at end of file
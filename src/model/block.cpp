@@ -3,7 +3,3 @@
 //
 
 #include "block.h"
-
-//Block::~Block() {
-//    delete cord;
-//}
\ No newline at end of file
@@ -8,23 +8,41 @@
 
 #include "point.h"
 
+// I1 and I2 in both orientations plus the empty block
+#define MAX_POSSIBLE_BLOCKS 5
+
 class Block {
 public:
-    Block(Point * cord, int type, int orientation, int id);
-    //~Block();
+    Block(Point cord = Point(), int type = 0, int orientation = 0, int id = 0);
 
-    Point * getCord() { return this->cord; };
+    Point & getCord() { return this->cord; };
     int getType() { return this->type; };
     int getOrientation() { return this->orientation; };
     int getId() { return this->id; };
 private:
-    Point * cord;
+    Point cord;
     int type;
     int orientation;
     int id;
 };
 
-Block::Block(Point * cord, int type, int orientation, int id) {
+// fixed capacity list of blocks, lives on the stack of whoever generates the moves
+class BlockList {
+public:
+    BlockList() { this->count = 0; }
+
+    void push_back(const Block & block) { this->blocks[this->count++] = block; }
+    int size() { return this->count; }
+
+    Block & operator [] (int i) { return this->blocks[i]; }
+    Block * begin() { return this->blocks; }
+    Block * end() { return this->blocks + this->count; }
+private:
+    Block blocks[MAX_POSSIBLE_BLOCKS];
+    int count;
+};
+
+inline Block::Block(Point cord, int type, int orientation, int id) {
 
     this->cord = cord;
     this->type = type;
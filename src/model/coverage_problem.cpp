@@ -2,6 +2,18 @@
 // Created by Adam Zvada on 2019-04-30.
 //
 
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+#include <climits>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "coverage_problem.h"
 
 istream & operator >> (istream &in, CoverageProblem &c)  {
@@ -18,15 +30,138 @@ istream & operator >> (istream &in, CoverageProblem &c)  {
     int numForbidden;
     in >> numForbidden;
 
+    c.forbiddenPoints.reserve(numForbidden);
     for (int i = 0; i < numForbidden; ++i) {
         Point point;
         in >> point;
         c.forbiddenPoints.push_back(point);
     }
 
+    c.buildBestFillCost();
+    c.buildSymmetries();
+
     return in;
 }
 
+// cursor over the mapped file, errors tell the line they were found on
+struct ProblemReader {
+    const char * cursor;
+    const char * end;
+    const char * path;
+    int line;
+
+    void skipSpace() {
+        while (this->cursor < this->end && isspace((unsigned char) *this->cursor)) {
+            if (*this->cursor == '\n') {
+                this->line++;
+            }
+            this->cursor++;
+        }
+    }
+
+    int readInt(const char * what) {
+
+        this->skipSpace();
+
+        bool isNegative = this->cursor < this->end && *this->cursor == '-';
+        if (isNegative) {
+            this->cursor++;
+        }
+
+        if (this->cursor == this->end || !isdigit((unsigned char) *this->cursor)) {
+            this->fail(string("expected ") + what);
+        }
+
+        long long value = 0;
+        while (this->cursor < this->end && isdigit((unsigned char) *this->cursor)) {
+            value = value * 10 + (*this->cursor - '0');
+            if (value > INT_MAX) {
+                this->fail(string(what) + " does not fit into an int");
+            }
+            this->cursor++;
+        }
+
+        return isNegative ? -value : value;
+    }
+
+    void fail(const string & message) {
+        throw runtime_error(string(this->path) + ":" + to_string(this->line) + ": " + message);
+    }
+};
+
+void CoverageProblem::load(const char * path) {
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        throw runtime_error(string(path) + ": " + strerror(errno));
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1 || fileStat.st_size == 0) {
+        close(fd);
+        throw runtime_error(string(path) + ": empty or unreadable file");
+    }
+
+    // the whole file is parsed straight from the page cache, nothing is copied into a stream buffer
+    size_t size = fileStat.st_size;
+    void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw runtime_error(string(path) + ": " + strerror(errno));
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    ProblemReader reader{(const char *) data, (const char *) data + size, path, 1};
+
+    try {
+        this->m = reader.readInt("row count");
+        this->n = reader.readInt("column count");
+        if (this->m <= 0 || this->n <= 0 || (long long) this->m * this->n > INT_MAX / 2) {
+            reader.fail("grid size " + to_string(this->m) + "x" + to_string(this->n) + " is out of range");
+        }
+
+        this->i1Length = reader.readInt("I1 length");
+        this->i2Length = reader.readInt("I2 length");
+        if (this->i1Length <= 0 || this->i2Length <= 0) {
+            reader.fail("block lengths must be positive");
+        }
+
+        this->i1Cost = reader.readInt("I1 cost");
+        this->i2Cost = reader.readInt("I2 cost");
+        this->penalization = reader.readInt("penalization");
+
+        int numForbidden = reader.readInt("forbidden point count");
+        if (numForbidden < 0 || numForbidden > this->m * this->n) {
+            reader.fail("forbidden point count " + to_string(numForbidden) + " is out of range");
+        }
+
+        // column goes first in the file, the same as operator >> of Point
+        this->forbiddenPoints.clear();
+        this->forbiddenPoints.reserve(numForbidden);
+        for (int i = 0; i < numForbidden; ++i) {
+            int y = reader.readInt("forbidden point column");
+            int x = reader.readInt("forbidden point row");
+            if (x < 0 || x >= this->m || y < 0 || y >= this->n) {
+                reader.fail("forbidden point " + to_string(y) + " " + to_string(x) + " lies outside the grid");
+            }
+            this->forbiddenPoints.emplace_back(x, y);
+        }
+
+        reader.skipSpace();
+        if (reader.cursor != reader.end) {
+            reader.fail("unexpected data after the last forbidden point");
+        }
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+
+    munmap(data, size);
+
+    this->buildBestFillCost();
+    this->buildSymmetries();
+}
+
 ostream & operator << (ostream &out, const CoverageProblem &c) {
 
     out << "Matrix size: ";
@@ -44,6 +179,75 @@ ostream & operator << (ostream &out, const CoverageProblem &c) {
     return out;
 }
 
+Point CoverageProblem::mapSymmetric(int symmetry, int x, int y) {
+
+    switch (symmetry) {
+        case SYMMETRY_FLIP_ROWS:
+            return Point(m - 1 - x, y);
+        case SYMMETRY_FLIP_COLUMNS:
+            return Point(x, n - 1 - y);
+        case SYMMETRY_ROTATE_180:
+            return Point(m - 1 - x, n - 1 - y);
+        case SYMMETRY_TRANSPOSE:
+            return Point(y, x);
+        case SYMMETRY_ANTI_TRANSPOSE:
+            return Point(n - 1 - y, m - 1 - x);
+        case SYMMETRY_ROTATE_90:
+            return Point(y, m - 1 - x);
+        default:
+            return Point(n - 1 - y, x);
+    }
+}
+
+void CoverageProblem::buildSymmetries() {
+
+    this->symmetries.clear();
+
+    vector<bool> isForbidden(m * n, false);
+    for (auto & point : this->forbiddenPoints) {
+        isForbidden[point.getX() * n + point.getY()] = true;
+    }
+
+    // a rectangle only has its reflections and the half turn, a square grid all eight
+    int candidates = m == n ? SYMMETRY_ROTATE_270 + 1 : SYMMETRY_TRANSPOSE;
+    for (int symmetry = 0; symmetry < candidates; ++symmetry) {
+
+        bool isInvariant = true;
+        for (auto & point : this->forbiddenPoints) {
+            Point image = this->mapSymmetric(symmetry, point.getX(), point.getY());
+            if (!isForbidden[image.getX() * n + image.getY()]) {
+                isInvariant = false;
+                break;
+            }
+        }
+
+        if (isInvariant) {
+            this->symmetries.push_back(symmetry);
+        }
+    }
+}
+
+void CoverageProblem::buildBestFillCost() {
+
+    int squares = m * n;
+
+    this->bestFillCost.assign(squares + 1, 0);
+
+    // every square is either left uncovered or it ends an I1 / I2 block
+    for (int i = 1; i <= squares; ++i) {
+        int best = this->bestFillCost[i - 1] + penalization;
+
+        if (i1Length > 0 && i >= i1Length) {
+            best = max(best, this->bestFillCost[i - i1Length] + i1Cost);
+        }
+        if (i2Length > 0 && i >= i2Length) {
+            best = max(best, this->bestFillCost[i - i2Length] + i2Cost);
+        }
+
+        this->bestFillCost[i] = best;
+    }
+}
+
 //int CoverageProblem::calculateUpperBoundPrice() {
 //
 //    int numCells = m * n - forbiddenPoints.size();
@@ -8,6 +8,14 @@
 
 #include "point.h"
 
+#define SYMMETRY_FLIP_ROWS 0
+#define SYMMETRY_FLIP_COLUMNS 1
+#define SYMMETRY_ROTATE_180 2
+#define SYMMETRY_TRANSPOSE 3
+#define SYMMETRY_ANTI_TRANSPOSE 4
+#define SYMMETRY_ROTATE_90 5
+#define SYMMETRY_ROTATE_270 6
+
 using namespace std;
 
 class CoverageProblem {
@@ -24,6 +32,18 @@ public:
 
     vector<Point> &getForbiddenPoints() { return this->forbiddenPoints; }
 
+    // maps the file and parses it in place, throws runtime_error with the file and line of a bad value
+    void load(const char * path);
+
+    // best price reachable by any mix of I1, I2 and uncovered squares, ignores the geometry
+    int getBestFillCost(int squares) { return this->bestFillCost[squares]; }
+
+    // symmetries of the grid that keep every forbidden point forbidden, found once the problem is loaded
+    vector<int> & getSymmetries() { return this->symmetries; }
+    Point mapSymmetric(int symmetry, int x, int y);
+    // the ones that swap rows with columns also turn horizontal blocks into vertical ones
+    bool isTransposing(int symmetry) { return symmetry >= SYMMETRY_TRANSPOSE; }
+
     friend istream & operator >> (istream &in, CoverageProblem &c);
     friend ostream & operator << (ostream &out, const CoverageProblem &c);
 private:
@@ -38,6 +58,12 @@ private:
 
     vector<Point> forbiddenPoints;
 
+    // indexed by number of squares, built once after the problem is loaded
+    vector<int> bestFillCost;
+    vector<int> symmetries;
+
+    void buildBestFillCost();
+    void buildSymmetries();
     int calculateUpperBoundPrice();
 };
 
@@ -2,11 +2,22 @@
 // Created by Adam Zvada on 2019-04-30.
 //
 
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <stdexcept>
+
 #include "grid.h"
 
+// mask with the lowest "length" bits set
+static inline uint64_t lowBits(int length) {
+    return length >= 64 ? ~0ULL : (1ULL << length) - 1;
+}
 
-Grid::Grid(CoverageProblem * problem) {
+Grid::Grid(CoverageProblem * problem, int boundType) {
     this->problem = problem;
+    this->boundType = boundType;
 
     this->rows = this->problem->getRowSize();
     this->columns = this->problem->getColumnSize();
@@ -14,6 +25,15 @@ Grid::Grid(CoverageProblem * problem) {
     this->buildGrid(this->rows, this->columns);
     this->addForbiddenPoints(problem);
 
+    if (this->boundType == BOUND_RUNS) {
+        for (int i = 0; i < this->rows; ++i) {
+            this->refreshRow(i);
+        }
+        for (int j = 0; j < this->columns; ++j) {
+            this->refreshColumn(j);
+        }
+    }
+
     // calculate initial cost "penalization"
     int penalization = this->problem->getPenalization();
     this->cost = (((this->rows * this->columns) - problem->getForbiddenPoints().size())*penalization);
@@ -22,84 +42,139 @@ Grid::Grid(CoverageProblem * problem) {
 Grid::Grid(Grid * grid, CoverageProblem * problem) {
 
     this->problem = problem;
+    this->boundType = grid->boundType;
 
     this->rows = this->problem->getRowSize();
     this->columns = this->problem->getColumnSize();
 
     this->cost = grid->getCost();
 
-    this->buildGrid(this->rows, this->columns);
+    this->bitboard = grid->bitboard;
+    this->placementCount = grid->placementCount;
+    this->placementCapacity = grid->placementCapacity;
+    this->idsValid = grid->idsValid;
 
-    // TODO: faster copy!
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < columns; ++j) {
-            this->grid[i][j] = grid->getGridValue(i, j);
-        }
-    }
+    this->allocateCells();
+    memcpy(this->cells, grid->cells, grid->usedBufferSize());
 }
 
 Grid::~Grid() {
-
-    for (int i = 0; i < this->rows; i++) {
-        delete[] grid[i];
-    }
-    delete[] grid;
+    GridPool::local().release(this->cells, this->bufferSize());
 }
 
 int Grid::getCostWithoutPenalty(Point * cord) {
+    return getCost() - problem->getPenalization()*this->countUnsolvedSquares(cord);
+}
 
-    int unsolvedSquares = 0;
-    if (cord != NULL) {
-        int x = cord->getX();
-        int y = cord->getY();
+int Grid::countUnsolvedSquares(Point * cord) {
+
+    if (cord == NULL) {
+        return 0;
+    }
 
+    int x = cord->getX();
+    int y = cord->getY();
+
+    // rest of the current column, the following columns are kept counted
+    int unsolvedSquares = 0;
+    if (this->bitboard) {
+        uint64_t freeSquares = ~this->columnMask[y] & lowBits(rows) & ~lowBits(x);
+        unsolvedSquares = __builtin_popcountll(freeSquares);
+    } else {
+        cell_t * column = this->cells + cellIndex(0, y);
         for (int i = x; i < rows; i++) {
-            if (this->grid[i][y] == 0) {
+            if (column[i] == EMPTY) {
                 unsolvedSquares++;
             }
         }
+    }
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = y + 1; j < columns; ++j) {
-                if (this->grid[i][j] == 0) {
-                    unsolvedSquares++;
-                }
-            }
+    for (int j = y + 1; j < columns; ++j) {
+        unsolvedSquares += this->emptyInColumn[j];
+    }
+
+    return unsolvedSquares;
+}
+
+int Grid::countDeadSquares(Point * cord) {
+
+    if (cord == NULL) {
+        return 0;
+    }
+
+    int x = cord->getX();
+    int y = cord->getY();
+
+    int deadSquares = 0;
+    uint8_t * column = this->shortRuns + cellIndex(0, y);
+    for (int i = x; i < rows; i++) {
+        if (column[i] & DEAD_SQUARE) {
+            deadSquares++;
         }
-    } else {
-        unsolvedSquares = 0;
     }
 
-    return getCost() - problem->getPenalization()*unsolvedSquares;
+    for (int j = y + 1; j < columns; ++j) {
+        deadSquares += this->deadInColumn[j];
+    }
+
+    return deadSquares;
 }
 
-bool Grid::addBlockIfPossible(Block * block) {
+bool Grid::addBlockIfPossible(Block & block) {
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
 
-    int blockSize = this->getBlockSize(block->getType());
+    int blockSize = this->getBlockSize(block.getType());
 
     // blockSize == 0
     if (x >= this->rows || y >= this->columns || y < 0 || x < 0) {
         return false;
     }
 
-    if (block->getOrientation() == EMPTY) {
+    if (block.getOrientation() == EMPTY) {
         return true;
     }
 
-    if (block->getOrientation() == HORIZONTAL) {
+    if (block.getOrientation() == HORIZONTAL) {
         return this->horizontalBlock(block, blockSize);
     }
 
-    if (block->getOrientation() == VERTICAL) {
+    if (block.getOrientation() == VERTICAL) {
         return this->verticalBlock(block, blockSize);
     }
 
     return false;
 }
 
+bool Grid::addBlockById(int i, int j, int id) {
+
+    Point cord(i, j);
+
+    if (id == ID_I1_VERTICAL) {
+        Block block(cord, TYPE_1, VERTICAL, id);
+        return this->addBlockIfPossible(block);
+    } else if (id == ID_I1_HORIZONTAL) {
+        Block block(cord, TYPE_1, HORIZONTAL, id);
+        return this->addBlockIfPossible(block);
+    } else if (id == ID_I2_VERTICAL) {
+        Block block(cord, TYPE_2, VERTICAL, id);
+        return this->addBlockIfPossible(block);
+    } else if (id == ID_I2_HORIZONTAL) {
+        Block block(cord, TYPE_2, HORIZONTAL, id);
+        return this->addBlockIfPossible(block);
+    }
+
+    return false;
+}
+
+bool Grid::addPlacement(Placement & placement) {
+
+    Block block(Point(placement.x, placement.y), placement.type, placement.orientation, placement.id);
+
+    return this->addBlockIfPossible(block);
+}
+
 //int Grid::addBlock(Point * cord, int id, int type, bool isHorizontal) {
 //
 //    int x = cord->getX();
@@ -115,9 +190,9 @@ bool Grid::addBlockIfPossible(Block * block) {
 //    return isHorizontal ? this->horizontalBlock(cord, id, blockSize) : this->verticalBlock(cord, id, blockSize);
 //}
 
-vector<Block*> Grid::generatePossibleBlocks(Point * cord) {
+BlockList Grid::generatePossibleBlocks(Point * cord) {
 
-    vector<Block*> possibleBlocks;
+    BlockList possibleBlocks;
 
     int blockSizeI1 = this->getBlockSize(TYPE_1);
     int blockSizeI2 = this->getBlockSize(TYPE_2);
@@ -128,72 +203,71 @@ vector<Block*> Grid::generatePossibleBlocks(Point * cord) {
 //    cout << "Cord: [" << cord->getX() << ", " << cord->getY() << "]" << endl;
 //    cout << *this;
 
-    if (this->getGridValue(cord->getX(), cord->getY()) == BLOCKED || this->getGridValue(cord->getX(), cord->getY()) > 0) {
+    if (!this->isEmpty(cord->getX(), cord->getY())) {
         return possibleBlocks;
     }
 
     // I1 - horizontal
     if (cord->getY() + blockSizeI1 - 1 < this->columns) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_1, HORIZONTAL, 2);
+        Block newBlock(*cord, TYPE_1, HORIZONTAL, ID_I1_HORIZONTAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
-    // TODO: Add IDs
     // I1 - vertical
     if (cord->getX() + blockSizeI1 - 1 < this->rows) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_1, VERTICAL, 1);
+        Block newBlock(*cord, TYPE_1, VERTICAL, ID_I1_VERTICAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
     // I2 - vertical
     if (cord->getX() + blockSizeI2 - 1 < this->rows) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_2, VERTICAL, 3);
+        Block newBlock(*cord, TYPE_2, VERTICAL, ID_I2_VERTICAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
     // I2 - horizontal
     if (cord->getY() + blockSizeI2 - 1 < this->columns) {
-        Block * newBlock = new Block(new Point(*cord), TYPE_2, HORIZONTAL, 4);
+        Block newBlock(*cord, TYPE_2, HORIZONTAL, ID_I2_HORIZONTAL);
         if (this->isBlockValid(newBlock)) {
             possibleBlocks.push_back(newBlock);
-        } else {
-            delete newBlock;
         }
     }
 
-    Block * emptyBlock = new Block(new Point(*cord), EMPTY, EMPTY, 0);
-    possibleBlocks.push_back(emptyBlock);
+    possibleBlocks.push_back(Block(*cord, EMPTY, EMPTY, 0));
 
     return possibleBlocks;
 }
 
-bool Grid::isBlockValid(Block * block) {
+bool Grid::isBlockValid(Block & block) {
 
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int orientation = block->getOrientation();
-    int blockSize = this->getBlockSize(block->getType());
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int orientation = block.getOrientation();
+    int blockSize = this->getBlockSize(block.getType());
+
+    if (this->bitboard) {
+        if (orientation == HORIZONTAL) {
+            return (this->rowMask[x] & (lowBits(blockSize) << y)) == 0;
+        } else if (orientation == VERTICAL) {
+            return (this->columnMask[y] & (lowBits(blockSize) << x)) == 0;
+        }
+        throw orientation;
+    }
 
     for (int i = 0; i < blockSize; ++i) {
         if (orientation == HORIZONTAL) {
-            if (this->grid[x][y + i] != 0) {
+            if (this->cells[cellIndex(x, y + i)] != 0) {
                 return false;
             }
         } else if (orientation == VERTICAL) {
-            if (this->grid[x + i][y] != 0) {
+            if (this->cells[cellIndex(x + i, y)] != 0) {
                 return false;
             }
         } else {
@@ -205,14 +279,42 @@ bool Grid::isBlockValid(Block * block) {
     return true;
 }
 
+int Grid::getGridValue(int i, int j) {
+
+    this->materializeIds();
+
+    return this->cells[cellIndex(i, j)];
+}
+
+void Grid::updateGridValue(int i, int j, int newVal) {
+
+    bool wasEmpty = this->isEmpty(i, j);
+    if (wasEmpty && newVal != EMPTY) {
+        this->emptyInColumn[j]--;
+    } else if (!wasEmpty && newVal == EMPTY) {
+        this->emptyInColumn[j]++;
+    }
+
+    this->materializeIds();
+    this->cells[cellIndex(i, j)] = (cell_t) newVal;
+    this->setOccupied(i, j, newVal != EMPTY);
+
+    if (this->boundType == BOUND_RUNS) {
+        this->refreshRow(i);
+        this->refreshColumn(j);
+    }
+}
+
 ostream & operator << (ostream &out, const Grid &g) {
 
 
     out << "[" << g.rows << ", " << g.columns<< "]" << endl;
 
+    g.materializeIds();
+
     for (int i = 0; i < g.rows; ++i) {
         for (int j = 0; j < g.columns; ++j) {
-            out << g.grid[i][j] << " ";
+            out << (int) g.cells[g.cellIndex(i, j)] << " ";
         }
         out << endl;
     }
@@ -223,19 +325,143 @@ ostream & operator << (ostream &out, const Grid &g) {
 }
 
 
-void Grid::buildGrid( int rows, int columns) {
+void Grid::buildGrid(int rows, int columns) {
+
+    this->rows = rows;
+    this->columns = columns;
+
+    this->bitboard = rows <= MAX_BITBOARD_SIZE && columns <= MAX_BITBOARD_SIZE;
+    this->placementCount = 0;
+    this->placementCapacity = rows * columns / max(1, this->getMinBlockLength()) + 1;
+    this->idsValid = true;
 
-    this->grid = new int*[rows];
+    this->allocateCells();
+    memset(this->cells, EMPTY, this->cellsSize());
+    memset(this->shortRuns, 0, this->cellsSize());
 
-    for (int i = 0; i < rows; ++i) {
-        this->grid[i] = new int[columns];
+    if (this->bitboard) {
+        memset(this->rowMask, 0, (rows + columns) * sizeof(uint64_t));
     }
 
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < columns; ++j) {
-            this->grid[i][j] = 0;
+    for (int j = 0; j < columns; ++j) {
+        this->emptyInColumn[j] = rows;
+        this->deadInColumn[j] = 0;
+    }
+}
+
+void Grid::allocateCells() {
+
+    void * buffer = GridPool::local().acquire(this->bufferSize());
+
+    // run flags, bitboards, column counters and placements live right behind the cells
+    // so a copy is still one memcpy, the placements go last so only the used part is copied
+    char * bytes = static_cast<char *>(buffer);
+    this->cells = reinterpret_cast<cell_t *>(bytes);
+    this->shortRuns = reinterpret_cast<uint8_t *>(bytes + this->cellsSize());
+
+    uint64_t * masks = reinterpret_cast<uint64_t *>(bytes + 2 * this->cellsSize());
+    this->rowMask = this->bitboard ? masks : nullptr;
+    this->columnMask = this->bitboard ? masks + this->rows : nullptr;
+
+    this->emptyInColumn = reinterpret_cast<int *>(masks + (this->bitboard ? this->rows + this->columns : 0));
+    this->deadInColumn = this->emptyInColumn + this->columns;
+    this->placements = reinterpret_cast<Placement *>(this->deadInColumn + this->columns);
+}
+
+size_t Grid::cellsSize() const {
+
+    // rounded up so that the buffer always ends on the alignment boundary
+    size_t size = (size_t) this->rows * this->columns * sizeof(cell_t);
+    return (size + CELL_ALIGNMENT - 1) / CELL_ALIGNMENT * CELL_ALIGNMENT;
+}
+
+size_t Grid::bufferSize() const {
+    return this->usedBufferSize() + (this->placementCapacity - this->placementCount) * sizeof(Placement);
+}
+
+size_t Grid::usedBufferSize() const {
+
+    size_t masksSize = this->bitboard ? (this->rows + this->columns) * sizeof(uint64_t) : 0;
+
+    return 2 * this->cellsSize() + masksSize + 2 * this->columns * sizeof(int)
+        + this->placementCount * sizeof(Placement);
+}
+
+void Grid::materializeIds() const {
+
+    if (this->idsValid) {
+        return;
+    }
+
+    // squares freed since the last time may still hold an old id
+    for (int j = 0; j < this->columns; ++j) {
+        for (int i = 0; i < this->rows; ++i) {
+            if (((this->columnMask[j] >> i) & 1) == 0) {
+                this->cells[cellIndex(i, j)] = EMPTY;
+            }
+        }
+    }
+
+    for (int k = 0; k < this->placementCount; ++k) {
+        Placement & placement = this->placements[k];
+        int length = placement.type == TYPE_1 ? this->problem->getI1Length() : this->problem->getI2Length();
+
+        for (int i = 0; i < length; ++i) {
+            if (placement.orientation == HORIZONTAL) {
+                this->cells[cellIndex(placement.x, placement.y + i)] = placement.id;
+            } else {
+                this->cells[cellIndex(placement.x + i, placement.y)] = placement.id;
+            }
+        }
+    }
+
+    this->idsValid = true;
+}
+
+void Grid::logPlacement(Block & block) {
+
+    Placement & placement = this->placements[this->placementCount++];
+    placement.x = (int16_t) block.getCord().getX();
+    placement.y = (int16_t) block.getCord().getY();
+    placement.type = (int8_t) block.getType();
+    placement.orientation = (int8_t) block.getOrientation();
+    placement.id = (int8_t) block.getId();
+
+    this->idsValid = !this->bitboard;
+}
+
+void Grid::unlogPlacement(Block & block) {
+
+    // blocks are undone in reverse order, so the match is almost always the last one
+    for (int k = this->placementCount - 1; k >= 0; --k) {
+        Placement & placement = this->placements[k];
+        if (placement.x == block.getCord().getX() && placement.y == block.getCord().getY()
+            && placement.id == block.getId()) {
+
+            memmove(this->placements + k, this->placements + k + 1, (this->placementCount - k - 1) * sizeof(Placement));
+            this->placementCount--;
+            this->idsValid = !this->bitboard;
+            return;
         }
     }
+
+    // undoing a block that was never placed is a bug of the caller
+    throw logic_error("undone block is not placed on the grid");
+}
+
+void Grid::setOccupied(int i, int j, bool isOccupied) {
+
+    if (!this->bitboard) {
+        return;
+    }
+
+    if (isOccupied) {
+        this->rowMask[i] |= 1ULL << j;
+        this->columnMask[j] |= 1ULL << i;
+    } else {
+        this->rowMask[i] &= ~(1ULL << j);
+        this->columnMask[j] &= ~(1ULL << i);
+    }
 }
 
 void Grid::addForbiddenPoints(CoverageProblem * problem) {
@@ -244,7 +470,11 @@ void Grid::addForbiddenPoints(CoverageProblem * problem) {
         int x = point.getX();
         int y = point.getY();
 
-        this->grid[x][y] = BLOCKED;
+        if (this->cells[cellIndex(x, y)] == EMPTY) {
+            this->emptyInColumn[y]--;
+        }
+        this->cells[cellIndex(x, y)] = BLOCKED;
+        this->setOccupied(x, y, true);
     }
 }
 
@@ -259,27 +489,43 @@ int Grid::getBlockSize(int type) {
     return 0;
 }
 
-bool Grid::horizontalBlock(Block * block, int length) {
+bool Grid::horizontalBlock(Block & block, int length) {
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int id = block->getId();
-    int type = block->getType();
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int id = block.getId();
+    int type = block.getType();
 
-    if (y + length - 1 > this->columns) {
+    if (y + length > this->columns) {
         return false;
     }
 
-    for (int i = 0; i < length; ++i) {
-        if (this->grid[x][y + i] != 0) {
+    if (this->bitboard) {
+        uint64_t span = lowBits(length) << y;
+        if (this->rowMask[x] & span) {
             return false;
         }
-    }
 
-    for (int i = 0; i < length; ++i) {
-        this->grid[x][y + i] = id;
+        this->rowMask[x] |= span;
+        for (int i = 0; i < length; ++i) {
+            this->columnMask[y + i] |= 1ULL << x;
+            this->emptyInColumn[y + i]--;
+        }
+    } else {
+        for (int i = 0; i < length; ++i) {
+            if (this->cells[cellIndex(x, y + i)] != 0) {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < length; ++i) {
+            this->cells[cellIndex(x, y + i)] = id;
+            this->emptyInColumn[y + i]--;
+        }
     }
 
+    this->logPlacement(block);
+    this->refreshRuns(x, y, HORIZONTAL, length);
 
     this->updateCost(type, length, true);
 
@@ -288,26 +534,42 @@ bool Grid::horizontalBlock(Block * block, int length) {
 }
 
 
-bool Grid::verticalBlock(Block * block, int length) {
+bool Grid::verticalBlock(Block & block, int length) {
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int id = block->getId();
-    int type = block->getType();
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int id = block.getId();
+    int type = block.getType();
 
-    if (x + length - 1 > this->rows) {
+    if (x + length > this->rows) {
         return false;
     }
 
-    for (int i = 0; i < length; i++) {
-        if (this->grid[x + i][y] != 0) {
+    if (this->bitboard) {
+        uint64_t span = lowBits(length) << x;
+        if (this->columnMask[y] & span) {
             return false;
         }
-    }
 
-    for (int i = 0; i < length; i++) {
-        this->grid[x + i][y] = id;
+        this->columnMask[y] |= span;
+        for (int i = 0; i < length; i++) {
+            this->rowMask[x + i] |= 1ULL << y;
+        }
+    } else {
+        for (int i = 0; i < length; i++) {
+            if (this->cells[cellIndex(x + i, y)] != 0) {
+                return false;
+            }
+        }
+
+        for (int i = 0; i < length; i++) {
+            this->cells[cellIndex(x + i, y)] = id;
+        }
     }
+    this->emptyInColumn[y] -= length;
+
+    this->logPlacement(block);
+    this->refreshRuns(x, y, VERTICAL, length);
 
     this->updateCost(type, length, true);
 
@@ -334,20 +596,33 @@ void Grid::updateCost(int type, int length, bool isAdded) {
     }
 }
 
-bool Grid::undoBlock(Block * block) {
+bool Grid::undoBlock(Block & block) {
+
+    int x = block.getCord().getX();
+    int y = block.getCord().getY();
+    int orientation = block.getOrientation();
+
+    // the empty block does not occupy any square
+    if (orientation == EMPTY) {
+        return true;
+    }
 
-    int x = block->getCord()->getX();
-    int y = block->getCord()->getY();
-    int orientation = block->getOrientation();
+    int blockSize = this->getBlockSize(block.getType());
 
-    int blockSize = this->getBlockSize(block->getType());
+    // ids of bitboard grids are not written, the log tells whether the block is placed
+    this->unlogPlacement(block);
 
     for (int i = 0; i < blockSize; ++i) {
-        if (this->grid[x][y] != block->getId()) {
-            throw 42; // TODO: Beter exception
-        }
+        if (this->bitboard) {
+            this->setOccupied(x, y, false);
+        } else {
+            if (this->cells[cellIndex(x, y)] != block.getId()) {
+                throw 42; // TODO: Beter exception
+            }
 
-        this->grid[x][y] = 0;
+            this->cells[cellIndex(x, y)] = 0;
+        }
+        this->emptyInColumn[y]++;
 
         if (orientation == VERTICAL) {
             x++;
@@ -355,10 +630,10 @@ bool Grid::undoBlock(Block * block) {
             y++;
         }
     }
-    // reduced the cost
-    this->updateCost(block->getType(), blockSize, false);
+    this->refreshRuns(block.getCord().getX(), block.getCord().getY(), orientation, blockSize);
 
-    delete block;
+    // reduced the cost
+    this->updateCost(block.getType(), blockSize, false);
 
     return true;
 }
@@ -372,56 +647,170 @@ int Grid::upperBoundCost(Point * cord) {
     // vraci maximalni cenu pro "number" nevyresenych policek
     // returns the maximal price for the "number" of unsolved squares
 
-    int unsolvedSquares = 0;
-    if (cord != NULL) {
-        int x = cord->getX();
-        int y = cord->getY();
+    int unsolvedSquares = this->countUnsolvedSquares(cord);
 
-        for (int i = x; i < rows; i++) {
-            if (this->grid[i][y] == 0) {
-                unsolvedSquares++;
+    if (this->boundType == BOUND_RUNS) {
+        // squares outside of any free run long enough for a block are never covered
+        int deadSquares = this->countDeadSquares(cord);
+        return problem->getBestFillCost(unsolvedSquares - deadSquares) + deadSquares * problem->getPenalization();
+    }
+
+    return problem->getBestFillCost(unsolvedSquares);
+}
+
+int Grid::getMinBlockLength() {
+
+    int i1Length = this->problem->getI1Length();
+    int i2Length = this->problem->getI2Length();
+
+    if (i1Length <= 0) {
+        return i2Length;
+    }
+    if (i2Length <= 0) {
+        return i1Length;
+    }
+
+    return min(i1Length, i2Length);
+}
+
+void Grid::refreshRuns(int x, int y, int orientation, int length) {
+
+    if (this->boundType != BOUND_RUNS) {
+        return;
+    }
+
+    // only the runs crossing the changed squares can split or merge
+    if (orientation == HORIZONTAL) {
+        this->refreshRow(x);
+        for (int j = y; j < y + length; ++j) {
+            this->refreshColumn(j);
+        }
+    } else if (orientation == VERTICAL) {
+        this->refreshColumn(y);
+        for (int i = x; i < x + length; ++i) {
+            this->refreshRow(i);
+        }
+    }
+}
+
+void Grid::refreshRow(int i) {
+
+    int minLength = this->getMinBlockLength();
+
+    int j = 0;
+    while (j < columns) {
+        if (!this->isEmpty(i, j)) {
+            this->updateDeadSquare(i, j);
+            j++;
+            continue;
+        }
+
+        int start = j;
+        while (j < columns && this->isEmpty(i, j)) {
+            j++;
+        }
+
+        bool isShort = j - start < minLength;
+        for (int k = start; k < j; ++k) {
+            if (isShort) {
+                this->shortRuns[cellIndex(i, k)] |= SHORT_HORIZONTAL;
+            } else {
+                this->shortRuns[cellIndex(i, k)] &= ~SHORT_HORIZONTAL;
             }
+            this->updateDeadSquare(i, k);
         }
+    }
+}
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = y + 1; j < columns; ++j) {
-                if (this->grid[i][j] == 0) {
-                    unsolvedSquares++;
-                }
+void Grid::refreshColumn(int j) {
+
+    int minLength = this->getMinBlockLength();
+
+    int i = 0;
+    while (i < rows) {
+        if (!this->isEmpty(i, j)) {
+            this->updateDeadSquare(i, j);
+            i++;
+            continue;
+        }
+
+        int start = i;
+        while (i < rows && this->isEmpty(i, j)) {
+            i++;
+        }
+
+        bool isShort = i - start < minLength;
+        for (int k = start; k < i; ++k) {
+            if (isShort) {
+                this->shortRuns[cellIndex(k, j)] |= SHORT_VERTICAL;
+            } else {
+                this->shortRuns[cellIndex(k, j)] &= ~SHORT_VERTICAL;
             }
+            this->updateDeadSquare(k, j);
         }
     }
+}
 
-    int i1Cost = problem->getI1Cost();
-    int i2Cost = problem->getI2Cost();
+void Grid::updateDeadSquare(int i, int j) {
 
-    int i1Size = problem->getI1Length();
-    int i2Size = problem->getI2Length();
+    int index = cellIndex(i, j);
+    uint8_t flags = this->shortRuns[index];
 
-    int penalty = problem->getPenalization();
+    bool isDead = this->isEmpty(i, j) && (flags & SHORT_HORIZONTAL) && (flags & SHORT_VERTICAL);
+    bool wasDead = (flags & DEAD_SQUARE) != 0;
 
-    int max = i2Cost * (unsolvedSquares/i2Size);
-    int reminder = unsolvedSquares % i2Size;
+    if (isDead != wasDead) {
+        this->shortRuns[index] ^= DEAD_SQUARE;
+        this->deadInColumn[j] += isDead ? 1 : -1;
+    }
+}
 
-    max += i1Cost * (reminder/i1Size);
-    reminder = reminder % i1Size;
-    max += reminder * penalty;
+GridPool::~GridPool() {
+    this->clear();
+}
 
-    int val = 0;
-    for (int i = 0; i < (unsolvedSquares/i2Size); i++) {
+GridPool & GridPool::local() {
+    static thread_local GridPool pool;
+    return pool;
+}
 
-        val = i2Cost * i;
+void * GridPool::acquire(size_t size) {
 
-        reminder = unsolvedSquares - (i * i2Size);
-        val += i2Cost * (reminder/i2Size);
+    if (size != this->bufferSize) {
+        this->clear();
+        this->bufferSize = size;
+        this->buffers.reserve(MAX_POOLED_GRIDS);
+    }
 
-        reminder = reminder % i1Size;
-        val += reminder * penalty;
+    if (!this->buffers.empty()) {
+        void * buffer = this->buffers.back();
+        this->buffers.pop_back();
+        return buffer;
+    }
 
-        if (val > max) {
-            max = val;
-        }
+    void * buffer = nullptr;
+    if (posix_memalign(&buffer, CELL_ALIGNMENT, size) != 0) {
+        throw bad_alloc();
     }
 
-    return max;
+    return buffer;
+}
+
+void GridPool::release(void * buffer, size_t size) {
+
+    // grids deleted by another thread than the one that built them end up here as well
+    if (size != this->bufferSize || this->buffers.size() >= MAX_POOLED_GRIDS) {
+        free(buffer);
+        return;
+    }
+
+    this->buffers.push_back(buffer);
+}
+
+void GridPool::clear() {
+
+    for (auto buffer : this->buffers) {
+        free(buffer);
+    }
+    this->buffers.clear();
 }
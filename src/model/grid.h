@@ -6,6 +6,7 @@
 #define COVERAGE_GRID_H
 
 #include <istream>
+#include <cstdint>
 
 #include "block.h"
 #include "coverage_problem.h"
@@ -19,43 +20,142 @@ using namespace std;
 #define HORIZONTAL 3
 #define VERTICAL 4
 
+// ids of the placed blocks
+#define ID_I1_VERTICAL 1
+#define ID_I1_HORIZONTAL 2
+#define ID_I2_VERTICAL 3
+#define ID_I2_HORIZONTAL 4
+
+#define CELL_ALIGNMENT 64
+#define MAX_BITBOARD_SIZE 64
+#define MAX_POOLED_GRIDS 1024
+
+// upper bound used for pruning
+#define BOUND_COUNT 0
+#define BOUND_RUNS 1
+
+// per square flags of the free runs it lies in
+#define SHORT_HORIZONTAL 1
+#define SHORT_VERTICAL 2
+#define DEAD_SQUARE 4
+
+// BLOCKED, EMPTY and block ids all fit into a byte
+typedef int8_t cell_t;
+
+// one placed block, grid keeps them in the order they were placed
+struct Placement {
+    int16_t x;
+    int16_t y;
+    int8_t type;
+    int8_t orientation;
+    int8_t id;
+};
+
+// free grid buffers of the calling thread, all grids of one problem share the buffer size
+class GridPool {
+public:
+    ~GridPool();
+
+    static GridPool & local();
+
+    void * acquire(size_t size);
+    void release(void * buffer, size_t size);
+private:
+    vector<void *> buffers;
+    size_t bufferSize = 0;
+
+    void clear();
+};
+
 class Grid {
 public:
-    Grid(CoverageProblem * problem);
+    Grid(CoverageProblem * problem, int boundType = BOUND_RUNS);
     Grid(Grid * grid, CoverageProblem * problem);
     ~Grid();
 
-    bool addBlockIfPossible(Block * block);
-    bool undoBlock(Block * block);
-    vector<Block*> generatePossibleBlocks(Point * cord);
+    bool addBlockIfPossible(Block & block);
+    bool addBlockById(int i, int j, int id);
+    bool addPlacement(Placement & placement);
+    bool undoBlock(Block & block);
+    BlockList generatePossibleBlocks(Point * cord);
 
     int getCost() { return this->cost; }
     int getCostWithoutPenalty(Point * cord);
-    int getGridValue(int i, int j) { return this->grid[i][j]; }
-    void updateGridValue(int i, int j, int newVal) { this->grid[i][j] = newVal; }
+    int getGridValue(int i, int j);
+    bool isEmpty(int i, int j) {
+        if (this->bitboard) {
+            return ((this->columnMask[j] >> i) & 1) == 0;
+        }
+        return this->cells[cellIndex(i, j)] == EMPTY;
+    }
+    void updateGridValue(int i, int j, int newVal);
+    // occupied squares of a column, only kept by grids up to MAX_BITBOARD_SIZE
+    bool isBitboard() { return this->bitboard; }
+    uint64_t getColumnMask(int j) { return this->columnMask[j]; }
     int upperBoundCost(Point * cord);
     int lowerBoundCost();
+    // EMPTY squares from cord to the end of the grid
+    int countUnsolvedSquares(Point * cord);
 
     void updateCost(int newCost) { this->cost = newCost; }
 
+    int getPlacementCount() { return this->placementCount; }
+    Placement & getPlacement(int i) { return this->placements[i]; }
+    void copyPlacements(vector<Placement> & out) { out.assign(this->placements, this->placements + this->placementCount); }
+
     friend ostream & operator << (ostream &out, const Grid &g);
 private:
     int rows;
     int columns;
-    int ** grid;
+    // single aligned buffer stored column by column, same order as the search walks it
+    cell_t * cells;
+    // SHORT_* and DEAD_SQUARE flags, only maintained for BOUND_RUNS
+    uint8_t * shortRuns;
+    // occupancy bitboards of grids up to 64x64, bit is set for every square that is not EMPTY
+    bool bitboard;
+    uint64_t * rowMask;
+    uint64_t * columnMask;
+    // number of EMPTY cells per column, updated on every placement
+    int * emptyInColumn;
+    // number of EMPTY cells per column no block can ever cover
+    int * deadInColumn;
+
+    int boundType;
+
+    // placed blocks, bitboard grids write their ids into cells only when they are read
+    Placement * placements;
+    int placementCount;
+    int placementCapacity;
+    mutable bool idsValid;
 
     int cost;
 
     CoverageProblem * problem;
 
 
+    int cellIndex(int i, int j) const { return j * this->rows + i; }
+
     void buildGrid(int m, int n);
+    void allocateCells();
+    size_t cellsSize() const;
+    size_t bufferSize() const;
+    size_t usedBufferSize() const;
+    void materializeIds() const;
+    void logPlacement(Block & block);
+    void unlogPlacement(Block & block);
+    void setOccupied(int i, int j, bool isOccupied);
+    int countDeadSquares(Point * cord);
+    int getMinBlockLength();
+    void refreshRuns(int x, int y, int orientation, int length);
+    void refreshRow(int i);
+    void refreshColumn(int j);
+    void updateDeadSquare(int i, int j);
     void addForbiddenPoints(CoverageProblem * problem);
     int getBlockSize(int type);
-    bool horizontalBlock(Block * block, int length);
-    bool verticalBlock(Block * block, int length);
+    bool horizontalBlock(Block & block, int length);
+    bool verticalBlock(Block & block, int length);
     void updateCost(int type, int length, bool isAdded = true);
-    bool isBlockValid(Block * block);
+    bool isBlockValid(Block & block);
 };
 
 #endif //COVERAGE_GRID_H
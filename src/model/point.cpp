@@ -10,11 +10,6 @@ Point::Point(int x, int y) {
     this->y = y;
 }
 
-Point::Point(const Point & p) {
-    this->x = p.x;
-    this->y = p.y;
-}
-
 istream & operator >> (istream &in,  Point &p)  {
 
     in >> p.y;
@@ -13,7 +13,6 @@ using namespace std;
 class Point {
 public:
     Point(int x = 0, int y = 0);
-    Point(const Point & p);
 
     int getX() { return this->x; }
     int getY() { return this->y; }
@@ -0,0 +1,191 @@
+#include "checkpoint.h"
+
+Checkpoint::Checkpoint(const char * path, CoverageProblem * problem) {
+
+    this->path = path;
+    this->problem = problem;
+    this->isLoaded = false;
+    this->cost = INT_MIN;
+    this->isRunning = false;
+}
+
+Checkpoint::~Checkpoint() {
+    this->stop();
+}
+
+bool Checkpoint::load() {
+
+    ifstream in(this->path, ios::in | ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    // the whole file is a sequence of ints in the byte order of the machine that wrote it
+    in.seekg(0, ios::end);
+    vector<int> data(in.tellg() / sizeof(int));
+    in.seekg(0, ios::beg);
+    in.read((char *) data.data(), data.size() * sizeof(int));
+
+    // magic, version, rows, columns, fingerprint, cost and the placement count
+    if (data.size() < 7 || data[0] != CHECKPOINT_MAGIC || data[1] != CHECKPOINT_VERSION ||
+        data[2] != this->problem->getRowSize() || data[3] != this->problem->getColumnSize() ||
+        data[4] != this->fingerprint()) {
+        throw runtime_error(this->path + ": checkpoint does not belong to this problem");
+    }
+
+    int counter = 7;
+    int placementCount = data[6];
+    if (placementCount < 0 || counter + placementCount >= (int) data.size()) {
+        throw runtime_error(this->path + ": checkpoint is truncated");
+    }
+
+    this->cost = data[5];
+    this->placements.assign(data.begin() + counter, data.begin() + counter + placementCount);
+    counter += placementCount;
+
+    // job count, then every job with its size in front
+    int jobCount = data[counter++];
+    for (int i = 0; i < jobCount; i++) {
+        int jobSize = counter < (int) data.size() ? data[counter] : -1;
+        if (jobSize < 2 || counter + 1 + jobSize > (int) data.size()) {
+            throw runtime_error(this->path + ": checkpoint is truncated");
+        }
+        this->loadedJobs.push_back(vector<int>(data.begin() + counter + 1, data.begin() + counter + 1 + jobSize));
+        counter += jobSize + 1;
+    }
+
+    this->isLoaded = true;
+
+    return true;
+}
+
+int Checkpoint::addJob(const vector<int> & job) {
+
+    lock_guard<mutex> guard(this->lock);
+
+    this->jobs.emplace_back();
+    this->jobs.back().data = job;
+    this->jobs.back().pieces = 1;
+
+    return this->jobs.size() - 1;
+}
+
+void Checkpoint::setIncumbent(int cost, const vector<int> & placements) {
+
+    lock_guard<mutex> guard(this->lock);
+
+    if (cost > this->cost) {
+        this->cost = cost;
+        this->placements = placements;
+    }
+}
+
+void Checkpoint::start() {
+
+    if (this->isRunning) {
+        return;
+    }
+
+    this->isRunning = true;
+    this->writer = thread(&Checkpoint::writeLoop, this);
+}
+
+void Checkpoint::stop() {
+
+    if (!this->isRunning) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->isRunning = false;
+    }
+    this->wakeUp.notify_one();
+    this->writer.join();
+
+    // no job is open any more, a resumed run just returns the solution
+    this->write();
+}
+
+void Checkpoint::writeLoop() {
+
+    unique_lock<mutex> guard(this->lock);
+
+    while (this->isRunning) {
+        this->wakeUp.wait_for(guard, chrono::seconds(CHECKPOINT_INTERVAL));
+        if (!this->isRunning) {
+            break;
+        }
+
+        guard.unlock();
+        this->write();
+        guard.lock();
+    }
+}
+
+int Checkpoint::fingerprint() {
+
+    // the order of the points in the input file does not matter
+    vector<pair<int, int>> points;
+    for (auto & point : this->problem->getForbiddenPoints()) {
+        points.push_back(make_pair(point.getY(), point.getX()));
+    }
+    sort(points.begin(), points.end());
+
+    vector<int> values = {this->problem->getI1Length(), this->problem->getI2Length(),
+                          this->problem->getI1Cost(), this->problem->getI2Cost(), this->problem->getPenalization()};
+    for (auto & point : points) {
+        values.push_back(point.first);
+        values.push_back(point.second);
+    }
+
+    // FNV-1a over the bytes of the values
+    uint32_t hash = 2166136261u;
+    for (int value : values) {
+        for (int i = 0; i < 4; i++) {
+            hash = (hash ^ (((uint32_t) value >> (8 * i)) & 0xff)) * 16777619u;
+        }
+    }
+
+    return (int) hash;
+}
+
+void Checkpoint::write() {
+
+    vector<int> data;
+    {
+        lock_guard<mutex> guard(this->lock);
+
+        data.push_back(CHECKPOINT_MAGIC);
+        data.push_back(CHECKPOINT_VERSION);
+        data.push_back(this->problem->getRowSize());
+        data.push_back(this->problem->getColumnSize());
+        data.push_back(this->fingerprint());
+
+        // jobs go before the incumbent is read, whatever a finished job found is in it already
+        vector<int> openJobs;
+        openJobs.push_back(0);
+        for (auto & job : this->jobs) {
+            if (job.pieces.load() > 0) {
+                openJobs.push_back(job.data.size());
+                openJobs.insert(openJobs.end(), job.data.begin(), job.data.end());
+                openJobs[0]++;
+            }
+        }
+
+        data.push_back(this->cost);
+        data.push_back(this->placements.size());
+        data.insert(data.end(), this->placements.begin(), this->placements.end());
+        data.insert(data.end(), openJobs.begin(), openJobs.end());
+    }
+
+    // the search goes on while the file is written, it replaces the old one only once complete
+    string tmpPath = this->path + ".tmp";
+    ofstream out(tmpPath, ios::out | ios::binary | ios::trunc);
+    out.write((const char *) data.data(), data.size() * sizeof(int));
+    out.close();
+
+    if (!out.fail()) {
+        rename(tmpPath.c_str(), this->path.c_str());
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef COVERAGE_CHECKPOINT_H
+#define COVERAGE_CHECKPOINT_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <climits>
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include "../../model/coverage_problem.h"
+
+#define CHECKPOINT_MAGIC 0x43565247
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_INTERVAL 60
+#define CHECKPOINT_JOBS 1024
+
+using namespace std;
+
+// subtree searched as one unit, it is done once it and everything split off it is searched
+struct CheckpointJob {
+    // cursor followed by the packed placements, the same as a serialized MPI job
+    vector<int> data;
+    atomic<int> pieces;
+};
+
+// open jobs and the best solution of a search, a background thread writes them to a binary file
+class Checkpoint {
+public:
+    Checkpoint(const char * path, CoverageProblem * problem);
+    ~Checkpoint();
+
+    // reads the file of an earlier run, false when there is none, throws runtime_error for a file of another problem
+    bool load();
+    bool isResumed() { return this->isLoaded; }
+    int getCost() { return this->cost; }
+    vector<int> & getPlacements() { return this->placements; }
+    vector<vector<int>> & getLoadedJobs() { return this->loadedJobs; }
+    vector<int> & getJob(int job) { return this->jobs[job].data; }
+
+    // jobs are added before start() or by the only thread that finishes them
+    int addJob(const vector<int> & job);
+    void splitJob(int job) { this->jobs[job].pieces++; }
+    void finishJob(int job) { this->jobs[job].pieces--; }
+    void setIncumbent(int cost, const vector<int> & placements);
+
+    // writes every CHECKPOINT_INTERVAL seconds until stop(), which writes the final state
+    void start();
+    void stop();
+private:
+    string path;
+    CoverageProblem * problem;
+
+    bool isLoaded;
+    vector<vector<int>> loadedJobs;
+
+    // guards the incumbent and adding jobs, the search itself only touches the atomic pieces
+    mutex lock;
+    deque<CheckpointJob> jobs;
+    int cost;
+    vector<int> placements;
+
+    thread writer;
+    bool isRunning;
+    condition_variable wakeUp;
+
+    void writeLoop();
+    void write();
+    // hash of the block settings and the sorted forbidden points, tells apart problems of the same size
+    int fingerprint();
+};
+
+
+#endif //COVERAGE_CHECKPOINT_H
@@ -9,9 +9,13 @@ Grid * Solver::solve() {
     Grid * grid = new Grid(problem);
 
     this->solutionGrid = new Grid(grid, problem);
+    this->bestCost = this->solutionGrid->getCost();
+    this->solutionCost = this->solutionGrid->getCost();
+    this->resumeIncumbent();
 
-
-    MPI_Init(nullptr, nullptr);
+    // only thread 0 of the slave team talks to the master
+    int provided;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &provided);
 
     solveMPI(grid);
 
@@ -20,11 +24,12 @@ Grid * Solver::solve() {
 //    {
 //        # pragma omp single
 //        {
-//            //this->solveLoop(grid);
 //            this->dfsRecursive(grid, new Point(0, 0), 0);
 //        };
 //    };
 
+    this->buildSolution();
+
     cout << "LBC: " << solutionGrid->lowerBoundCost() << endl;
     cout << "UBC: " << solutionGrid->upperBoundCost(new Point(0, 0)) << endl;
     cout << "C: " << solutionGrid->getCost() << endl;
@@ -32,359 +37,1004 @@ Grid * Solver::solve() {
     return solutionGrid;
 }
 
+thread_local int Solver::activeJob = 0;
+thread_local int Solver::splitCount = 0;
+
+Solver::~Solver() {
+    delete this->transpositions;
+}
+
 Solver::Solver(CoverageProblem * problem) {
     this->problem = problem;
     this->solutionGrid = nullptr;
+    this->executor = nullptr;
+    this->isDonating = false;
+    this->isSplitAsked = false;
+    this->isDonationWanted = false;
+    this->masterComm = MPI_COMM_WORLD;
+    this->checkpoint = nullptr;
+
+    // the frontier is read from the column masks, only bitboard grids keep them
+    bool isBitboard = problem->getRowSize() <= MAX_BITBOARD_SIZE && problem->getColumnSize() <= MAX_BITBOARD_SIZE;
+    this->transpositions = isBitboard ? new TranspositionTable(problem) : nullptr;
+
+    // at first only the top of the tree is split
+    int freeSquares = problem->getRowSize() * problem->getColumnSize() - problem->getForbiddenPoints().size();
+    this->splitCutoff = max(MIN_SPLIT_SQUARES, freeSquares * 3 / 4);
 }
 
 Grid * Solver::solveMPI(Grid * grid) {
 
-    // initial position
-    Point * cord = new Point(0, 0);
-    if (grid->getGridValue(cord->getX(), cord->getY()) == BLOCKED) {
-        cord = this->nextCord(cord, grid);
+    int rank;
+    int numProcesses;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+    int numSlaves = numProcesses - 1;
+
+    // the other ranks only seeded their incumbent from the checkpoint, rank 0 keeps track of the jobs
+    if (rank != 0) {
+        this->checkpoint = nullptr;
     }
 
-    queue<pair<Grid*, Point*>> q;
+    // flat topology, rank 0 coordinates every slave itself
+    MPI_Comm groupComm = MPI_COMM_WORLD;
+    MPI_Comm leaderComm = MPI_COMM_NULL;
+    bool isLeader = false;
+    int groupSize = numSlaves;
 
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // too many slaves for one master, they are split into groups and the first rank of each leads it
+    bool isHierarchical = numSlaves > SLAVES_PER_GROUP;
+    if (isHierarchical) {
+
+        // every sub-master keeps at least one slave of its own
+        int groups = min((numSlaves + SLAVES_PER_GROUP - 1) / SLAVES_PER_GROUP, numSlaves / 2);
+        groupSize = numSlaves / groups;
+
+        // consecutive ranks share a group, so that it mostly stays within a node
+        int group = rank == 0 ? MPI_UNDEFINED : (rank - 1) * groups / numSlaves;
+        MPI_Comm_split(MPI_COMM_WORLD, group, rank, &groupComm);
+
+        int groupRank = -1;
+        if (groupComm != MPI_COMM_NULL) {
+            MPI_Comm_rank(groupComm, &groupRank);
+        }
+        isLeader = groupRank == 0;
+
+        // rank 0 hands out the jobs only to the sub-masters
+        MPI_Comm_split(MPI_COMM_WORLD, rank == 0 || isLeader ? 0 : MPI_UNDEFINED, rank, &leaderComm);
+    }
 
     if (rank == 0) {
 
-        int numProcesses;
-        MPI_Comm_size(MPI_COMM_WORLD, &numProcesses);
+        // first jobs come from the top of the tree, later ones are split off busy workers on demand
+        vector<SearchNode> frontier = this->expandFrontier(grid, numSlaves * JOBS_PER_WORKER);
 
-        // Run BFS and feed the queue with first jobs
-        q.push(make_pair(grid, cord));
+        queue<vector<int>> q;
+        for (auto & node : frontier) {
+            q.push(jobSerialization(node.grid, &node.cord));
+            delete node.grid;
+        }
 
-        // generate numJobs and store it in queue
-        while (q.size() < numProcesses) {
+        // a sub-master passes the jobs on to its whole group, so its batches are as big as the group
+        if (isHierarchical) {
+            this->coordinate(leaderComm, MPI_COMM_NULL, q, JOBS_PER_BATCH * groupSize);
+        } else {
+            this->coordinate(MPI_COMM_WORLD, MPI_COMM_NULL, q, JOBS_PER_BATCH);
+        }
 
-            auto stateJob = q.front();
-            q.pop();
+        if (this->checkpoint != nullptr) {
+            this->checkpoint->stop();
+        }
+
+    } else if (isLeader) {
+
+        delete grid;
+
+        // the queue is filled only by the batches from rank 0
+        queue<vector<int>> q;
+        this->coordinate(groupComm, leaderComm, q, JOBS_PER_BATCH);
+
+    } else {
+
+        delete grid;
+        this->isDonating = true;
+        this->sharedCost = this->bestCost;
+        this->masterComm = groupComm;
 
-            // generate state jobs, it stores is in queue
-            auto stateJobs = this->bfs(stateJob.first, stateJob.second, 1);
-            delete stateJob.first;
-            delete stateJob.second;
+        int workers = omp_get_max_threads();
+        WorkStealingExecutor executor(workers);
+        executor.open();
+        this->executor = &executor;
 
-            // iterate over queue and add job states to the main job queue
-            while (!stateJobs.empty()) {
-                q.push(stateJobs.front());
+        // one team for the whole run, thread 0 talks to the master and feeds the jobs to the others
+# pragma omp parallel num_threads(workers)
+        {
+            int worker = omp_get_thread_num();
 
-                stateJobs.pop();
+            if (worker == 0) {
+                this->communicate(executor);
+            } else {
+                SearchNode node;
+                while (executor.pop(worker, node)) {
+                    this->dfsRecursive(node.grid, &node.cord, node.depth);
+                    delete node.grid;
+                    executor.finish();
+                }
             }
+        };
+
+        this->executor = nullptr;
+        this->isDonating = false;
+    }
+
+    if (isHierarchical) {
+        if (groupComm != MPI_COMM_NULL) {
+            MPI_Comm_free(&groupComm);
+        }
+        if (leaderComm != MPI_COMM_NULL) {
+            MPI_Comm_free(&leaderComm);
         }
+    }
 
-        // distribute jobs to all slaves
-        for (int i = 1; i < numProcesses; i++) {
-            pair<Grid*, Point*> stateJob = q.front();
+    MPI_Finalize();
+
+    return this->solutionGrid;
+}
+
+void Solver::coordinate(MPI_Comm slaves, MPI_Comm master, queue<vector<int>> & q, int maxBatchJobs) {
+
+    int numProcesses;
+    MPI_Comm_size(slaves, &numProcesses);
+    int numSlaves = numProcesses - 1;
+
+    // batches sent to a slave and not answered yet, the first one is searched and the rest wait in its buffer
+    vector<int> sentBatches(numProcesses, 0);
+    vector<bool> isAskedToSplit(numProcesses, false);
+
+    // best cost reported by any slave, its grid comes later with the job result
+    int globalCost = this->bestCost;
+
+    // a sub-master is a single slave for rank 0, every batch it got is answered once the whole group is idle
+    int receivedBatches = 0;
+
+    // rank 0 knows which jobs every unanswered batch holds, they stay open in the checkpoint until it is answered
+    bool isTracking = this->checkpoint != nullptr && master == MPI_COMM_NULL;
+    queue<int> queuedJobs;
+    vector<deque<vector<int>>> batchJobs(numProcesses);
+    if (isTracking) {
+        for (int i = 0; i < (int) q.size(); i++) {
+            queuedJobs.push(this->checkpoint->addJob(q.front()));
+            q.push(q.front());
             q.pop();
+        }
+        this->checkpoint->start();
+    }
 
-            vector<int> serializedJob = jobSerialization(stateJob.first, stateJob.second);
-            delete stateJob.first;
-            delete stateJob.second;
+    vector<int> message;
+    MPI_Status mpiStatus;
+    while (true) {
+
+        // idle slaves are served first, then the ones that would run dry after their current batch
+        int batchSize = max(1, min(maxBatchJobs, (int) q.size() / (numSlaves * PREFETCHED_BATCHES)));
+        for (int sent = 0; sent < PREFETCHED_BATCHES; sent++) {
+            for (int i = 1; i < numProcesses && !q.empty(); i++) {
+                if (sentBatches[i] == sent) {
+                    if (isTracking) {
+                        batchJobs[i].push_back(vector<int>());
+                        for (int j = 0; j < batchSize && !queuedJobs.empty(); j++) {
+                            batchJobs[i].back().push_back(queuedJobs.front());
+                            queuedJobs.pop();
+                        }
+                    }
+                    this->sendBatch(q, slaves, i, batchSize);
+                    sentBatches[i]++;
+                }
+            }
+        }
 
-            // send index init workers?
-            int jobSize = serializedJob.size();
-            MPI_Send(&jobSize, 1, MPI_INT, i, TAG_INIT_SIZE, MPI_COMM_WORLD); // TAG_INIT - 0
+        int workingSlaves = 0;
+        bool isAnyIdle = false;
+        for (int i = 1; i < numProcesses; i++) {
+            if (sentBatches[i] > 0) {
+                workingSlaves++;
+            } else {
+                isAnyIdle = true;
+            }
+        }
 
-            MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, i, TAG_JOB, MPI_COMM_WORLD); // TAG_WORK - 1
+        if (master == MPI_COMM_NULL) {
+            if (workingSlaves == 0) {
+                break;
+            }
+        } else if (workingSlaves == 0 && q.empty() && receivedBatches > 0) {
+            vector<int> groupResult = resultSerialization(this->buildSolution());
+            for (; receivedBatches > 0; receivedBatches--) {
+                MPI_Send(groupResult.data(), groupResult.size(), MPI_INT, 0, TAG_DONE, master);
+            }
+            this->isDonationWanted = false;
         }
 
-        MPI_Status mpiStatus;
-        int workingSlaves = numProcesses - 1;
-        while (workingSlaves > 0) {
+        // rank 0 asked this group for a subtree, a job nobody started yet goes first
+        if (this->isDonationWanted && !q.empty()) {
+            MPI_Send(q.front().data(), q.front().size(), MPI_INT, 0, TAG_DONATE, master);
+            q.pop();
+            this->isDonationWanted = false;
+        }
 
-            int jobResultSize;
-            MPI_Recv(&jobResultSize, 1, MPI_INT, MPI_ANY_SOURCE, TAG_INIT_SIZE, MPI_COMM_WORLD, &mpiStatus);
+        // queue ran dry while some slaves are idle, every busy slave is asked to donate a subtree
+        if (isAnyIdle || this->isDonationWanted) {
+            int idleCount = numSlaves - workingSlaves;
+            for (int i = 1; i < numProcesses; i++) {
+                if (sentBatches[i] > 0 && !isAskedToSplit[i]) {
+                    MPI_Send(&idleCount, 1, MPI_INT, i, TAG_SPLIT, slaves);
+                    isAskedToSplit[i] = true;
+                }
+            }
+        }
 
-            vector<int> jobResult;
-            jobResult.resize(jobResultSize);
-            MPI_Recv(&jobResult[0], jobResultSize, MPI_INT, mpiStatus.MPI_SOURCE, TAG_DONE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            pair<Grid*, Point*> resultJob = jobDeserialization(jobResult);
+        // a sub-master listens to rank 0 and to its group, so it cannot block on either of them
+        int isReceived = 0;
+        if (master != MPI_COMM_NULL) {
+            MPI_Iprobe(0, MPI_ANY_TAG, master, &isReceived, &mpiStatus);
+        }
 
-            if (resultJob.first->getCost() > this->solutionGrid->getCost()) {
+        if (isReceived) {
+            this->receiveMessage(master, mpiStatus, message);
 
-                cout << "Found better Grid." << endl;
-                cout << *resultJob.first;
+            if (mpiStatus.MPI_TAG == TAG_FINISHED) {
+                break;
+            }
 
-                delete this->solutionGrid;
-                this->solutionGrid = new Grid(resultJob.first, this->problem);
+            if (mpiStatus.MPI_TAG == TAG_JOB) {
+                // jobs only pass through, they stay serialized until a slave gets them
+                int counter = 1;
+                for (int i = 0; i < message[0]; i++) {
+                    int jobSize = message[counter];
+                    q.push(vector<int>(message.begin() + counter + 1, message.begin() + counter + 1 + jobSize));
+                    counter += jobSize + 1;
+                }
+                receivedBatches++;
+            } else if (mpiStatus.MPI_TAG == TAG_BOUND) {
+                if (message[0] > globalCost) {
+                    globalCost = message[0];
+                    for (int i = 1; i < numProcesses; i++) {
+                        MPI_Send(&globalCost, 1, MPI_INT, i, TAG_BOUND, slaves);
+                    }
+                }
+            } else if (mpiStatus.MPI_TAG == TAG_SPLIT && receivedBatches > 0) {
+                this->isDonationWanted = true;
             }
+            continue;
+        }
 
-            if (!q.empty()) {
-                // send new job from queue
-                pair<Grid*, Point*> stateJob = q.front();
-                q.pop();
+        // every message comes in one piece, its size is known from the probe
+        if (master == MPI_COMM_NULL) {
+            MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, slaves, &mpiStatus);
+        } else {
+            MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, slaves, &isReceived, &mpiStatus);
+            if (!isReceived) {
+                this_thread::yield();
+                continue;
+            }
+        }
 
-                vector<int> serializedJob = jobSerialization(stateJob.first, stateJob.second);
-                delete stateJob.first;
-                delete stateJob.second;
+        int slave = mpiStatus.MPI_SOURCE;
+        this->receiveMessage(slaves, mpiStatus, message);
 
-                int jobSize = serializedJob.size();
-                MPI_Send(&jobSize , 1, MPI_INT, mpiStatus.MPI_SOURCE, TAG_INIT_SIZE, MPI_COMM_WORLD); // TAG_INIT - 0
+        if (mpiStatus.MPI_TAG == TAG_BOUND) {
+            if (message[0] > globalCost) {
+                globalCost = message[0];
+                for (int i = 1; i < numProcesses; i++) {
+                    if (i != slave) {
+                        MPI_Send(&globalCost, 1, MPI_INT, i, TAG_BOUND, slaves);
+                    }
+                }
+                // only the improvement goes up, rank 0 forwards it to the other groups
+                if (master != MPI_COMM_NULL) {
+                    MPI_Send(&globalCost, 1, MPI_INT, 0, TAG_BOUND, master);
+                }
+            }
+            continue;
+        }
 
-                MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, mpiStatus.MPI_SOURCE, TAG_JOB, MPI_COMM_WORLD); // TAG_WORK - 1
+        if (mpiStatus.MPI_TAG == TAG_DONATE) {
+            if (this->isDonationWanted) {
+                MPI_Send(message.data(), message.size(), MPI_INT, 0, TAG_DONATE, master);
+                this->isDonationWanted = false;
             } else {
-                // Inform about finish
-                MPI_Send(&workingSlaves, 1, MPI_INT, mpiStatus.MPI_SOURCE, TAG_FINISHED, MPI_COMM_WORLD);
-                workingSlaves--;
+                q.push(message);
+                // the subtree stays a piece of the job it was split off, like a split inside one rank
+                if (isTracking) {
+                    int job = this->findDonorJob(batchJobs[slave], message);
+                    if (job != -1) {
+                        this->checkpoint->splitJob(job);
+                    } else {
+                        job = this->checkpoint->addJob(message);
+                    }
+                    queuedJobs.push(job);
+                }
             }
+            isAskedToSplit[slave] = false;
+            continue;
         }
 
-    } else {
+        if (message[0] > this->bestCost) {
 
-        bool endIndicator = false;
-        MPI_Status mpiStatus;
+            Grid * resultGrid = this->deserializePlacements(&message[1], message.size() - 1);
 
-        while (!endIndicator) {
+            cout << "Found better Grid." << endl;
+            cout << *resultGrid;
 
-            int jobSize;
-            MPI_Recv(&jobSize, 1, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpiStatus);
+            this->offerSolution(resultGrid);
+            delete resultGrid;
+        }
 
-            if (mpiStatus.MPI_TAG != TAG_FINISHED) {
-                // MPI_SOURCE should be MASTER!
-                vector<int> job;
-                job.resize(jobSize);
-                MPI_Recv(&job[0], jobSize, MPI_INT, mpiStatus.MPI_SOURCE, TAG_JOB, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                pair<Grid*, Point*> jobState = jobDeserialization(job);
+        if (isTracking) {
+            for (int job : batchJobs[slave].front()) {
+                this->checkpoint->finishJob(job);
+            }
+            batchJobs[slave].pop_front();
+        }
 
-                Grid *jobResult;
-# pragma omp parallel
-                {
-# pragma omp single
-                    jobResult = dfsRecursive(jobState.first, jobState.second, 0);
-                }
-                vector<int> jobResultSerialized = jobSerialization(jobResult, jobState.second);
-                //delete jobState.first;
-                //delete jobState.second;
-                //delete jobResult;
+        sentBatches[slave]--;
+        if (sentBatches[slave] == 0) {
+            isAskedToSplit[slave] = false;
+        }
+    }
 
-                cout << "Slave finished computation." << endl;
+    // Inform about finish
+    int workingSlaves = 0;
+    for (int i = 1; i < numProcesses; i++) {
+        MPI_Send(&workingSlaves, 1, MPI_INT, i, TAG_FINISHED, slaves);
+    }
+}
 
-                int jobResultSize = jobResultSerialized.size();
-                MPI_Send(&jobResultSize, 1, MPI_INT, mpiStatus.MPI_SOURCE, TAG_INIT_SIZE, MPI_COMM_WORLD);
-                MPI_Send(jobResultSerialized.data(), jobResultSize, MPI_INT, mpiStatus.MPI_SOURCE, TAG_DONE, MPI_COMM_WORLD);
-            } else {
-                endIndicator = true;
+int Solver::findDonorJob(deque<vector<int>> & batches, vector<int> & subtree) {
+
+    int rows = this->problem->getRowSize();
+
+    // the subtree repeats the placements of its job and adds only blocks from the cursor of the job on
+    for (auto & batch : batches) {
+        for (int job : batch) {
+            vector<int> & data = this->checkpoint->getJob(job);
+            if (subtree.size() < data.size() || !equal(data.begin() + 2, data.end(), subtree.begin() + 2)) {
+                continue;
+            }
+
+            int cursor = data[1] * rows + data[0];
+            bool isInside = true;
+            for (int i = data.size(); i < (int) subtree.size() && isInside; i++) {
+                int x = subtree[i] >> 16;
+                int y = (subtree[i] >> 3) & 0x1FFF;
+                isInside = y * rows + x >= cursor;
+            }
+
+            // jobs are disjoint subtrees, so only one of them can hold it
+            if (isInside) {
+                return job;
             }
         }
     }
 
-    MPI_Finalize();
+    return -1;
+}
 
-    return this->solutionGrid;
+void Solver::receiveMessage(MPI_Comm comm, MPI_Status & status, vector<int> & message) {
+
+    int messageSize;
+    MPI_Get_count(&status, MPI_INT, &messageSize);
+    message.resize(messageSize);
+    MPI_Recv(&message[0], messageSize, MPI_INT, status.MPI_SOURCE, status.MPI_TAG, comm, MPI_STATUS_IGNORE);
 }
 
-queue<pair<Grid*, Point*>> Solver::bfs(Grid * grid, Point * cord, int depth) {
+void Solver::resumeIncumbent() {
 
-    Grid * curGrid = grid;
-    Point * curCord = cord;
+    if (this->checkpoint == nullptr || !this->checkpoint->isResumed()) {
+        return;
+    }
+
+    // the grid is rebuilt from its placements, so the cost cannot disagree with the layout
+    vector<int> & placements = this->checkpoint->getPlacements();
+    Grid * grid = this->deserializePlacements(placements.data(), placements.size());
+    this->offerSolution(grid);
+    delete grid;
+}
 
-    queue<pair<Grid*, Point*>> q;
+vector<SearchNode> Solver::expandFrontier(Grid * grid, int minNodes) {
 
-    while(q.size() < depth) {
+    vector<SearchNode> frontier;
 
-        if (!q.empty()) {
-            pair<Grid*, Point*> state = q.front();
+    // a resumed search starts from the jobs its checkpoint left open, none of them when it had finished
+    if (this->checkpoint != nullptr && this->checkpoint->isResumed()) {
+        for (auto & job : this->checkpoint->getLoadedJobs()) {
+            pair<Grid*, Point*> jobState = jobDeserialization(job.data(), job.size());
+            frontier.push_back(SearchNode{jobState.first, *jobState.second, 0});
+            delete jobState.second;
+        }
+        delete grid;
+    } else {
+        frontier.push_back(SearchNode{grid, Point(0, 0), 0});
+    }
 
-            curGrid = state.first;
-            curCord = this->nextCord(state.second, curGrid);
+    // level by level, so all states are about the same size
+    while (!frontier.empty() && (int) frontier.size() < minNodes) {
 
-            q.pop();
+        vector<SearchNode> nextLevel;
+        for (auto & node : frontier) {
+            this->expandNode(node, nextLevel);
         }
+        frontier.swap(nextLevel);
+    }
+
+    return frontier;
+}
 
-        vector<Block*> possibleBlocks = curGrid->generatePossibleBlocks(curCord);
-        for (auto block : possibleBlocks) {
+void Solver::sendBatch(queue<vector<int>> & q, MPI_Comm slaves, int slave, int jobCount) {
 
-            if (curGrid->addBlockIfPossible(block)) {
+    vector<int> batch;
+    batch.push_back(0);
 
-                Grid *newGrid = new Grid(curGrid, problem);
-                Point *newCord = new Point(curCord->getX(), curCord->getY());
-                newCord = this->nextCord(newCord, newGrid);
+    while (batch[0] < jobCount && !q.empty()) {
+        vector<int> & serializedJob = q.front();
+        batch.push_back(serializedJob.size());
+        batch.insert(batch.end(), serializedJob.begin(), serializedJob.end());
+        batch[0]++;
+        q.pop();
+    }
 
-                q.push(make_pair(newGrid, newCord));
+    MPI_Send(batch.data(), batch.size(), MPI_INT, slave, TAG_JOB, slaves);
+}
+
+int Solver::maxBatchSize() {
+
+    // job count, then every job with its size in front, a block covers at least one square
+    int maxJobSize = 2 + this->problem->getRowSize() * this->problem->getColumnSize();
+    return 1 + JOBS_PER_BATCH * (1 + maxJobSize);
+}
 
-                curGrid->undoBlock(block);
+void Solver::communicate(WorkStealingExecutor & executor) {
+
+    // the next batch is received in the background while the current one is searched
+    vector<int> nextBatch;
+    nextBatch.resize(this->maxBatchSize());
+
+    MPI_Request nextRequest;
+    MPI_Irecv(&nextBatch[0], nextBatch.size(), MPI_INT, 0, TAG_JOB, this->masterComm, &nextRequest);
+
+    int threads = omp_get_num_threads();
+    bool isSearching = false;
+
+    while (true) {
+
+        // every job of the batch is done, the master gets the best grid of this slave
+        if (isSearching && executor.getPendingNodes() == 0) {
+            // subtrees split off during the batch must reach the master before its result
+            this->donateSubtrees(executor);
+
+            vector<int> jobResultSerialized = resultSerialization(this->buildSolution());
+
+            cout << "Slave finished computation." << endl;
+
+            MPI_Send(jobResultSerialized.data(), jobResultSerialized.size(), MPI_INT, 0, TAG_DONE, this->masterComm);
+            isSearching = false;
+        }
+
+        if (!isSearching) {
+            int isReceived;
+            MPI_Status batchStatus;
+            MPI_Test(&nextRequest, &isReceived, &batchStatus);
+
+            if (isReceived) {
+                this->pushBatch(executor, nextBatch);
+                MPI_Irecv(&nextBatch[0], nextBatch.size(), MPI_INT, 0, TAG_JOB, this->masterComm, &nextRequest);
+                isSearching = true;
             }
+        }
 
+        if (!this->pollMaster(executor)) {
+            MPI_Cancel(&nextRequest);
+            MPI_Wait(&nextRequest, MPI_STATUS_IGNORE);
+            executor.close();
+            return;
         }
+
+        if (!isSearching) {
+            // the batch was finished before the split request came
+            this->isDonationWanted = false;
+            this->isSplitAsked = false;
+        }
+
+        // without a team thread 0 searches itself and polls the master from inside the search
+        if (threads == 1) {
+            SearchNode node;
+            if (executor.tryPop(0, node)) {
+                this->dfsRecursive(node.grid, &node.cord, node.depth);
+                delete node.grid;
+                executor.finish();
+                continue;
+            }
+        }
+
+        this_thread::yield();
     }
+}
 
-    return q;
-};
+void Solver::pushBatch(WorkStealingExecutor & executor, vector<int> & batch) {
 
+    // job count followed by the size and the data of every job, all of them wait in the queue of thread 0
+    int counter = 1;
+    for (int i = 0; i < batch[0]; i++) {
+        int jobSize = batch[counter];
+        pair<Grid*, Point*> jobState = jobDeserialization(&batch[counter + 1], jobSize);
+        counter += jobSize + 1;
 
-vector<int> Solver::jobSerialization(Grid * grid, Point * point) {
+        executor.push(0, jobState.first, *jobState.second, 0, 0);
+        delete jobState.second;
+    }
+}
 
-    int rows = this->problem->getRowSize();
-    int columns = this->problem->getColumnSize();
+bool Solver::pollMaster(WorkStealingExecutor & executor) {
 
-    vector<int> serializedJob;
+    // only control tags are probed, a prefetched batch may wait behind the posted receive and must stay for it
+    const int controlTags[] = {TAG_BOUND, TAG_SPLIT, TAG_FINISHED};
+    for (int tag : controlTags) {
 
-    serializedJob.push_back(point->getX());
-    serializedJob.push_back(point->getY());
+        int isControl;
+        MPI_Iprobe(0, tag, this->masterComm, &isControl, MPI_STATUS_IGNORE);
+
+        while (isControl) {
 
-    serializedJob.push_back(grid->getCost());
+            int value;
+            MPI_Recv(&value, 1, MPI_INT, 0, tag, this->masterComm, MPI_STATUS_IGNORE);
 
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < columns; j++) {
-            serializedJob.push_back(grid->getGridValue(i, j));
+            if (tag == TAG_FINISHED) {
+                return false;
+            } else if (tag == TAG_BOUND) {
+                this->raiseBestCost(value);
+            } else if (tag == TAG_SPLIT) {
+                this->isDonationWanted = true;
+                this->isSplitAsked = true;
+            }
+
+            MPI_Iprobe(0, tag, this->masterComm, &isControl, MPI_STATUS_IGNORE);
         }
     }
 
-    return serializedJob;
+    this->shareBestCost();
+    this->donateSubtrees(executor);
 
+    return true;
 }
 
-pair<Grid*, Point*> Solver::jobDeserialization(vector<int> & serializedJob) {
+void Solver::donateSubtrees(WorkStealingExecutor & executor) {
 
-    int rows = this->problem->getRowSize();
-    int columns = this->problem->getColumnSize();
+    vector<SearchNode> nodes;
+#pragma omp critical (donation)
+    {
+        nodes.swap(this->donatedNodes);
+    };
 
-    Point * cord = new Point(serializedJob[0], serializedJob[1]);
-    Grid * grid = new Grid(this->problem);
-    grid->updateCost(serializedJob[2]);
+    for (auto & node : nodes) {
+        vector<int> serializedJob = jobSerialization(node.grid, &node.cord);
+        MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, 0, TAG_DONATE, this->masterComm);
+        delete node.grid;
+        this->isDonationWanted = false;
+    }
+
+    if (!this->isDonationWanted) {
+        return;
+    }
+
+    // a job nobody started yet goes first, but only while this slave keeps some other work
+    SearchNode node;
+    if (executor.getPendingNodes() > 1 && executor.tryPop(0, node)) {
+        vector<int> serializedJob = jobSerialization(node.grid, &node.cord);
+        MPI_Send(serializedJob.data(), serializedJob.size(), MPI_INT, 0, TAG_DONATE, this->masterComm);
+        delete node.grid;
+        executor.finish();
+
+        this->isDonationWanted = false;
+        this->isSplitAsked = false;
+        return;
+    }
+
+    // the searching threads split one off
+    this->isSplitAsked = true;
+}
 
-    int counter = 3;
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < columns; j++) {
-            grid->updateGridValue(i, j, serializedJob[counter]);
-            counter++;
+bool Solver::splitForMaster(Grid * grid, Point * cord, int depth) {
+
+    // thread 0 searches only when it has no team, probing on every node would cost more than the search itself
+    if (omp_get_thread_num() == 0) {
+        static thread_local int visitedNodes = 0;
+        if (++visitedNodes % DONATION_POLL_INTERVAL == 0) {
+            this->pollMaster(*this->executor);
         }
     }
 
-    return make_pair(grid, cord);
+    // small subtrees are searched here, a bigger one comes up once the search returns higher
+    if (!this->isSplitAsked.load(memory_order_relaxed) || grid->countUnsolvedSquares(cord) < MIN_DONATED_SQUARES) {
+        return false;
+    }
+
+    bool isAsked = true;
+    if (!this->isSplitAsked.compare_exchange_strong(isAsked, false)) {
+        return false;
+    }
+
+    // kept apart from the executor, so that no other thread of the team steals it
+    Grid * donatedGrid = new Grid(grid, problem);
+#pragma omp critical (donation)
+    {
+        this->donatedNodes.push_back(SearchNode{donatedGrid, *cord, depth});
+    };
+
+    return true;
 }
 
+void Solver::shareBestCost() {
 
-Grid * Solver::solveLoop(Grid * grid) {
+    // own improvement goes to the master, it forwards it to all other slaves
+    int best = this->bestCost.load();
+    if (best > this->sharedCost) {
+        MPI_Send(&best, 1, MPI_INT, 0, TAG_BOUND, this->masterComm);
+        this->sharedCost = best;
+    }
+}
 
-    int depth = 10;
+void Solver::raiseBestCost(int cost) {
 
-    queue<pair<Grid*, Point*>> q;
+    // only prunes harder, the grid with this cost is kept by the rank that found it
+    int best = this->bestCost.load();
+    while (cost > best && !this->bestCost.compare_exchange_weak(best, cost)) {
+    }
 
-    // initial position
-    Point * cord = new Point(0, 0);
-    if (grid->getGridValue(cord->getX(), cord->getY()) == BLOCKED) {
-        cord = this->nextCord(cord, grid);
+    if (cost > this->sharedCost) {
+        this->sharedCost = cost;
     }
+}
 
-    Grid * curGrid = grid;
-    Point * curCord = cord;
-    while(q.size() < depth) {
 
-        if (!q.empty()) {
-            pair<Grid*, Point*> state = q.front();
+vector<int> Solver::jobSerialization(Grid * grid, Point * point) {
 
-            curGrid = state.first;
-            curCord = this->nextCord(state.second, curGrid);
+    // cursor followed by the placements from the root
+    vector<int> serializedJob;
+    serializedJob.reserve(2 + grid->getPlacementCount());
 
-            q.pop();
-        }
+    serializedJob.push_back(point->getX());
+    serializedJob.push_back(point->getY());
+    this->serializePlacements(grid, serializedJob);
+
+    return serializedJob;
+}
 
-        vector<Block*> possibleBlocks = curGrid->generatePossibleBlocks(curCord);
-        for (auto block : possibleBlocks) {
+pair<Grid*, Point*> Solver::jobDeserialization(const int * serializedJob, int jobSize) {
 
-            if (curGrid->addBlockIfPossible(block)) {
+    Point * cord = new Point(serializedJob[0], serializedJob[1]);
+    Grid * grid = this->deserializePlacements(serializedJob + 2, jobSize - 2);
 
-                Grid *newGrid = new Grid(curGrid, problem);
-                Point *newCord = new Point(0, 0);
+    return make_pair(grid, cord);
+}
 
-                cout << *newGrid << endl;
+vector<int> Solver::resultSerialization(Grid * grid) {
 
-                q.push(make_pair(newGrid, newCord));
+    // cost goes first, so the master rebuilds just the grids that improve its solution
+    vector<int> serializedResult;
+    serializedResult.reserve(1 + grid->getPlacementCount());
 
-                curGrid->undoBlock(block);
-            }
+    serializedResult.push_back(grid->getCost());
+    this->serializePlacements(grid, serializedResult);
+
+    return serializedResult;
+}
+
+void Solver::serializePlacements(Grid * grid, vector<int> & out) {
+
+    // one int per block, the id tells its type and orientation
+    for (int i = 0; i < grid->getPlacementCount(); i++) {
+        Placement & placement = grid->getPlacement(i);
+        out.push_back((placement.x << 16) | (placement.y << 3) | placement.id);
+    }
+}
+
+Grid * Solver::deserializePlacements(const int * placements, int count) {
+
+    Grid * grid = new Grid(this->problem);
 
+    for (int i = 0; i < count; i++) {
+        grid->addBlockById(placements[i] >> 16, (placements[i] >> 3) & 0x1FFF, placements[i] & 7);
+    }
+
+    return grid;
+}
+
+void Solver::expandNode(SearchNode & node, vector<SearchNode> & children) {
+
+    Grid * grid = node.grid;
+
+    BlockList possibleBlocks = grid->generatePossibleBlocks(&node.cord);
+    if (possibleBlocks.size() == 0) {
+
+        // nothing to place here, the same grid moves on to the next square
+        Point next = node.cord;
+        if (this->nextCord(next, grid) &&
+            grid->upperBoundCost(&next) + grid->getCostWithoutPenalty(&next) > this->bestCost.load() &&
+            this->isCanonical(grid, &node.cord, &next)) {
+            children.push_back(SearchNode{grid, next, node.depth + 1});
+        } else {
+            delete grid;
         }
+        return;
     }
 
-    //#pragma omp parallel for //default(shared)
-    for (int i = 0; i < q.size(); i++) {
+    for (int i = 0; i < possibleBlocks.size(); i++) {
 
-        pair<Grid*, Point*> jobState = q.front();
-        q.pop();
+        if (grid->addBlockIfPossible(possibleBlocks[i])) {
 
-        dfsRecursive(jobState.first, jobState.second, 0);
+            this->offerSolution(grid);
+
+            Point next = node.cord;
+            if (this->nextCord(next, grid) &&
+                grid->upperBoundCost(&next) + grid->getCostWithoutPenalty(&next) > this->bestCost.load() &&
+                this->isCanonical(grid, &node.cord, &next)) {
+                children.push_back(SearchNode{new Grid(grid, problem), next, node.depth + 1});
+            }
+
+            if (possibleBlocks[i].getType() != EMPTY) {
+                grid->undoBlock(possibleBlocks[i]);
+            }
+        }
     }
 
-    return this->solutionGrid;
+    delete grid;
 }
 
+
 Grid * Solver::dfsRecursive(Grid * grid, Point * cord, int depth) {
 
     if (cord == nullptr) {
         return this->solutionGrid;
     }
 
-    vector<Block*> possibleBlocks = grid->generatePossibleBlocks(cord);
+    // the same frontier was searched before and nothing behind it beats the incumbent from this cost
+    uint64_t key = this->transpositionKey(grid, cord);
+    int bound;
+    if (key != 0 && this->transpositions->probe(key, bound) &&
+        grid->getCost() + bound <= this->bestCost.load(memory_order_relaxed)) {
+        return this->solutionGrid;
+    }
+    int splits = splitCount;
+
+    // blocks are placed into and undone from the same grid, it is only copied for a split off subtree
+    BlockList possibleBlocks = grid->generatePossibleBlocks(cord);
     if (possibleBlocks.size() == 0) {
 
-        Point * nextCord = this->nextCord(cord, grid);
+        Point next = *cord;
+        Point * nextCord = this->nextCord(next, grid) ? &next : nullptr;
 
-        if (grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord) > this->solutionGrid->getCost()) {
-            Grid * newGrid = new Grid(grid, problem);
-# pragma omp task if (depth < THRESHOLD)
-            {
-                this->dfsRecursive(newGrid, nextCord, ++depth);
-            };
+        int bound = grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord);
+        if (bound > this->bestCost.load(memory_order_relaxed) && this->isCanonical(grid, cord, nextCord)) {
+            this->dfsChild(grid, nextCord, depth + 1, bound);
         }
 
-        delete cord;
-
         return this->solutionGrid;
     }
 
-    //for (auto block : possibleBlocks) {
-    //#pragma omp parallel for //default(shared)
     for (int i = 0; i < possibleBlocks.size(); i++) {
 
         bool isAdded = grid->addBlockIfPossible(possibleBlocks[i]);
 
         if (isAdded) {
 
-#pragma omp critical
-            {
-                if (grid->getCost() > this->solutionGrid->getCost()) {
-                    delete this->solutionGrid;
-                    this->solutionGrid = new Grid(grid, this->problem);
-                }
-            };
+            this->offerSolution(grid);
 
-            Point *nextCord = this->nextCord(cord, grid);
+            Point next = *cord;
+            Point * nextCord = this->nextCord(next, grid) ? &next : nullptr;
 
-            if (grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord) > this->solutionGrid->getCost()) {
-                Grid * newGrid = new Grid(grid, problem);
-# pragma omp task if (depth < THRESHOLD)
-                {
-                    this->dfsRecursive(newGrid, nextCord, ++depth);
-                };
+            int bound = grid->upperBoundCost(nextCord) + grid->getCostWithoutPenalty(nextCord);
+            if (bound > this->bestCost.load(memory_order_relaxed) && this->isCanonical(grid, cord, nextCord)) {
+                this->dfsChild(grid, nextCord, depth + 1, bound);
             }
 
-            if (possibleBlocks[i]->getType() != EMPTY) {
+            if (possibleBlocks[i].getType() != EMPTY) {
                 grid->undoBlock(possibleBlocks[i]);
             }
         }
     }
 
-    delete cord;
-    delete grid;
+    this->storeTransposition(grid, cord, key, splits);
+
+    return this->solutionGrid;
+}
+
+void Solver::dfsChild(Grid * grid, Point * cord, int depth, int bound) {
+
+    if (cord == nullptr) {
+        return;
+    }
+
+    if (this->isDonating && this->splitForMaster(grid, cord, depth)) {
+        splitCount++;
+        return;
+    }
+
+    if (!this->isWorthSplitting(grid, cord, bound)) {
+        this->dfsRecursive(grid, cord, depth);
+        return;
+    }
+
+    splitCount++;
+
+    // the job stays open until the split off piece is searched too
+    if (this->checkpoint != nullptr) {
+        this->checkpoint->splitJob(activeJob);
+    }
+    this->executor->push(omp_get_thread_num(), new Grid(grid, problem), *cord, depth, activeJob);
+}
+
+bool Solver::isCanonical(Grid * grid, Point * cord, Point * next) {
+
+    // checked once a column is finished, only the first columns are worth the scan
+    vector<int> & symmetries = this->problem->getSymmetries();
+    if (symmetries.empty() || next == nullptr || next->getY() == cord->getY() || next->getY() > SYMMETRY_COLUMNS) {
+        return true;
+    }
+
+    // squares before the cursor are final, every symmetric layout keeps the same cost
+    int rows = this->problem->getRowSize();
+    int decided = next->getY() * rows + next->getX();
+
+    for (int symmetry : symmetries) {
+        bool isTransposing = this->problem->isTransposing(symmetry);
+
+        // the layout is searched only if it is column by column no bigger than its image
+        for (int k = 0; k < decided; k++) {
+            int x = k % rows;
+            int y = k / rows;
+
+            Point image = this->problem->mapSymmetric(symmetry, x, y);
+            if (image.getY() * rows + image.getX() >= decided) {
+                break;
+            }
+
+            int value = grid->getGridValue(x, y);
+            int imageValue = grid->getGridValue(image.getX(), image.getY());
+            if (isTransposing && imageValue > 0) {
+                // ids go vertical, horizontal for I1 and then for I2
+                imageValue = imageValue % 2 == 1 ? imageValue + 1 : imageValue - 1;
+            }
+
+            if (value > imageValue) {
+                return false;
+            }
+            if (value < imageValue) {
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+uint64_t Solver::transpositionKey(Grid * grid, Point * cord) {
+
+    // symmetric layouts are pruned depending on the columns before the frontier, their subtrees are not comparable
+    if (this->transpositions == nullptr ||
+        (!this->problem->getSymmetries().empty() && cord->getY() < SYMMETRY_COLUMNS)) {
+        return 0;
+    }
+
+    // small subtrees are searched faster than looked up
+    int rows = this->problem->getRowSize();
+    if ((this->problem->getColumnSize() - cord->getY()) * rows - cord->getX() < TRANSPOSITION_MIN_SQUARES) {
+        return 0;
+    }
+
+    return this->transpositions->hash(grid, cord);
+}
+
+void Solver::storeTransposition(Grid * grid, Point * cord, uint64_t key, int splits) {
+
+    // a piece split off is still searched elsewhere, the incumbent does not cover it yet
+    if (key == 0 || splitCount != splits) {
+        return;
+    }
+
+    // no layout behind the frontier beats the incumbent, it bounds what any other way to the frontier can add
+    int rows = this->problem->getRowSize();
+    int squares = (this->problem->getColumnSize() - cord->getY()) * rows - cord->getX();
+    this->transpositions->store(key, this->bestCost.load(memory_order_relaxed) - grid->getCost(), squares);
+}
+
+bool Solver::isWorthSplitting(Grid * grid, Point * cord, int bound) {
+
+    int threads = omp_get_num_threads();
+    if (threads == 1 || this->executor == nullptr) {
+        return false;
+    }
+
+    // split only when the other threads run out of work
+    if (!this->executor->isHungry(omp_get_thread_num())) {
+        return false;
+    }
+
+    // a bound barely above the incumbent gets pruned within a few blocks
+    int blockCost = max(this->problem->getI1Cost(), this->problem->getI2Cost());
+    if (bound - this->bestCost.load(memory_order_relaxed) <= blockCost) {
+        return false;
+    }
+
+    int cutoff = this->splitCutoff.load(memory_order_relaxed);
+    if (grid->countUnsolvedSquares(cord) >= cutoff) {
+        return true;
+    }
+
+    // nothing big enough is left while threads are starving, accept smaller subtrees from now on
+    if (cutoff > MIN_SPLIT_SQUARES) {
+        this->splitCutoff.store(cutoff - 1, memory_order_relaxed);
+    }
+
+    return false;
+}
+
+void Solver::offerSolution(Grid * grid) {
+
+    int cost = grid->getCost();
+    int best = this->bestCost.load();
+
+    // pruning only reads the atomic cost, placements are copied just for a real improvement
+    while (cost > best) {
+        if (this->bestCost.compare_exchange_weak(best, cost)) {
+#pragma omp critical (solution)
+            {
+                if (cost > this->solutionCost) {
+                    grid->copyPlacements(this->bestPlacements);
+                    this->solutionCost = cost;
+
+                    if (this->checkpoint != nullptr) {
+                        vector<int> placements;
+                        this->serializePlacements(grid, placements);
+                        this->checkpoint->setIncumbent(cost, placements);
+                    }
+                }
+            };
+            return;
+        }
+    }
+}
+
+Grid * Solver::buildSolution() {
+
+    if (this->solutionCost <= this->solutionGrid->getCost()) {
+        return this->solutionGrid;
+    }
+
+    delete this->solutionGrid;
+    this->solutionGrid = new Grid(this->problem);
+    for (auto & placement : this->bestPlacements) {
+        this->solutionGrid->addPlacement(placement);
+    }
 
     return this->solutionGrid;
 }
 
 Point * Solver::nextCord(Point * cord, Grid * grid) {
 
+    Point next = *cord;
+    if (!this->nextCord(next, grid)) {
+        return nullptr;
+    }
+
+    return new Point(next);
+}
+
+bool Solver::nextCord(Point & cord, Grid * grid) {
+
     int rows = this->problem->getRowSize();
     int columns = this->problem->getColumnSize();
 
-    int x = cord->getX();
-    int y = cord->getY();
-    //delete cord;
+    int x = cord.getX();
+    int y = cord.getY();
 
     do {
         if (x + 1 < rows) {
@@ -397,11 +1047,13 @@ Point * Solver::nextCord(Point * cord, Grid * grid) {
             y++;
             continue;
         }
-    } while (grid->getGridValue(x,y) != 0 && !(x + 1 == rows && y + 1 == columns));
+    } while (!grid->isEmpty(x, y) && !(x + 1 == rows && y + 1 == columns));
 
     if (x + 1 == rows && y + 1 == columns) {
-        return nullptr;
+        return false;
     }
 
-    return new Point(x, y);
+    cord = Point(x, y);
+
+    return true;
 }
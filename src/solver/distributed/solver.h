@@ -8,42 +8,116 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <stack>
 #include <omp.h>
 #include <chrono>
 #include <queue>
+#include <atomic>
+#include <thread>
 #include <mpi.h>
 
 #include "../../model/grid.h"
 #include "../../model/coverage_problem.h"
+#include "../task-parallel/executor.h"
+#include "../checkpoint/checkpoint.h"
+#include "../transposition/transposition_table.h"
 
-#define THRESHOLD 10
+#define SYMMETRY_COLUMNS 4
+#define TRANSPOSITION_MIN_SQUARES 16
+
+#define MIN_SPLIT_SQUARES 4
+
+#define JOBS_PER_WORKER 4
+#define MIN_DONATED_SQUARES 8
+#define DONATION_POLL_INTERVAL 1024
+#define JOBS_PER_BATCH 8
+#define PREFETCHED_BATCHES 2
+#define SLAVES_PER_GROUP 16
 
 class Solver {
 public:
     Solver(CoverageProblem * problem);
+    ~Solver();
 
     Grid * solve();
+
+    void setCheckpoint(Checkpoint * checkpoint) { this->checkpoint = checkpoint; }
 private:
     CoverageProblem * problem;
     Grid * solutionGrid;
+    // best cost found so far, read without locking when pruning
+    atomic<int> bestCost;
+    // placements leading to the best grid, solutionGrid is rebuilt from them on demand
+    vector<Placement> bestPlacements;
+    int solutionCost;
+    // set while the slave team runs, subtrees are only split into its deques
+    WorkStealingExecutor * executor;
+    // fewest EMPTY squares a subtree needs to be split off, lowered while threads starve
+    atomic<int> splitCutoff;
+    // set on MPI slaves, their search hands a subtree back to the master when asked for it
+    bool isDonating;
+    atomic<bool> isSplitAsked;
+    // master asked for a subtree, thread 0 sends the next one split off
+    bool isDonationWanted;
+    vector<SearchNode> donatedNodes;
+    // best cost this slave and the master both know about, only thread 0 touches it
+    int sharedCost;
+    // rank 0 of it is the master of this slave, the sub-master of its group once the ranks are grouped
+    MPI_Comm masterComm;
+    // open jobs and the incumbent are written to it while the search runs, null without a checkpoint
+    Checkpoint * checkpoint;
+    // best price still reachable behind a column frontier, null when the grid keeps no bitboards
+    TranspositionTable * transpositions;
+    // checkpoint job of the node the calling thread searches
+    static thread_local int activeJob;
+    // subtrees the calling thread handed over to other threads or ranks
+    static thread_local int splitCount;
 
     Grid * solveMPI(Grid * grid);
-    Grid * solveLoop(Grid * grid);
+    void resumeIncumbent();
+    vector<SearchNode> expandFrontier(Grid * grid, int minNodes);
 
-    queue<pair<Grid*, Point*>> bfs(Grid * grid, Point * cord, int depth);
     Grid * dfsRecursive(Grid * grid, Point * cord, int depth);
+    void dfsChild(Grid * grid, Point * cord, int depth, int bound);
+    bool isWorthSplitting(Grid * grid, Point * cord, int bound);
+    bool isCanonical(Grid * grid, Point * cord, Point * next);
+    uint64_t transpositionKey(Grid * grid, Point * cord);
+    void storeTransposition(Grid * grid, Point * cord, uint64_t key, int splits);
+    bool splitForMaster(Grid * grid, Point * cord, int depth);
+    void communicate(WorkStealingExecutor & executor);
+    void pushBatch(WorkStealingExecutor & executor, vector<int> & batch);
+    bool pollMaster(WorkStealingExecutor & executor);
+    void donateSubtrees(WorkStealingExecutor & executor);
+    void shareBestCost();
+    void raiseBestCost(int cost);
+    void coordinate(MPI_Comm slaves, MPI_Comm master, queue<vector<int>> & q, int maxBatchJobs);
+    void receiveMessage(MPI_Comm comm, MPI_Status & status, vector<int> & message);
+    void sendBatch(queue<vector<int>> & q, MPI_Comm slaves, int slave, int jobCount);
+    // open job of the given batches the donated subtree was split off, -1 when none holds it
+    int findDonorJob(deque<vector<int>> & batches, vector<int> & subtree);
+    int maxBatchSize();
 
     vector<int> jobSerialization(Grid * grid, Point * point);
-    pair<Grid*, Point*> jobDeserialization(vector<int> & serializedJob);
+    pair<Grid*, Point*> jobDeserialization(const int * serializedJob, int jobSize);
+    vector<int> resultSerialization(Grid * grid);
+    void serializePlacements(Grid * grid, vector<int> & out);
+    Grid * deserializePlacements(const int * placements, int count);
+    void expandNode(SearchNode & node, vector<SearchNode> & children);
+
+    void offerSolution(Grid * grid);
+    Grid * buildSolution();
 
     Point * nextCord(Point * cord, Grid * grid);
+    bool nextCord(Point & cord, Grid * grid);
 
-    const int TAG_INIT_SIZE = 0;
     const int TAG_JOB = 1;
     const int TAG_RESULT= 2;
     const int TAG_DONE = 3;
     const int TAG_FINISHED = 4;
+    const int TAG_SPLIT = 5;
+    const int TAG_DONATE = 6;
+    const int TAG_BOUND = 7;
 };
 
 #endif //COVERAGE_SOLVER_H
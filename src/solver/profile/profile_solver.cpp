@@ -0,0 +1,218 @@
+#include "profile_solver.h"
+
+ProfileSolver::ProfileSolver(CoverageProblem * problem) {
+
+    this->rows = problem->getRowSize();
+    this->columns = problem->getColumnSize();
+    this->reach = max(1, max(problem->getI1Length(), problem->getI2Length()));
+
+    // digits go up to the length of the longest block minus the square it already covers
+    this->stateCount = 1;
+    for (int i = 0; i <= this->rows; i++) {
+        this->power.push_back((int) min(this->stateCount, (long long) INT_MAX));
+        this->stateCount = min(this->stateCount * this->reach, (long long) PROFILE_MAX_STATES + 1);
+    }
+
+    // about the square root of the column count, a layer is kept at every stride-th column and the rest is swept again
+    this->stride = 1;
+    while ((long long) this->stride * this->stride < this->columns) {
+        this->stride++;
+    }
+
+    // a column starts with no vertical block running, so its layer has at most reach^rows profiles
+    long long layerSize = this->stateCount / this->reach;
+    long long keptLayers = (this->columns + this->stride - 1) / this->stride + this->stride;
+    this->memory = keptLayers * layerSize * 2 * sizeof(int) + this->stateCount * (5 * sizeof(int) + this->rows * (sizeof(int) + 1));
+
+    // a free grid reaches about every profile, every column is swept once forward, once to rebuild the kept layers
+    // and once with the choices
+    this->work = this->stateCount * this->rows * this->columns * 3;
+
+    this->isForbidden.assign(this->rows * this->columns, 0);
+    for (auto & point : problem->getForbiddenPoints()) {
+        this->isForbidden[point.getY() * this->rows + point.getX()] = 1;
+    }
+
+    int penalization = problem->getPenalization();
+    int lengths[] = {problem->getI1Length(), problem->getI2Length()};
+    int costs[] = {problem->getI1Cost(), problem->getI2Cost()};
+    for (int type = TYPE_1; type <= TYPE_2; type++) {
+        int length = lengths[type - TYPE_1];
+        if (length <= 0) {
+            continue;
+        }
+
+        int gain = costs[type - TYPE_1] - length * penalization;
+        int verticalId = type == TYPE_1 ? ID_I1_VERTICAL : ID_I2_VERTICAL;
+        int horizontalId = type == TYPE_1 ? ID_I1_HORIZONTAL : ID_I2_HORIZONTAL;
+        this->blocks.push_back(ProfileBlock{type, VERTICAL, verticalId, length, gain});
+        this->blocks.push_back(ProfileBlock{type, HORIZONTAL, horizontalId, length, gain});
+    }
+}
+
+bool ProfileSolver::isBlockValid(int state, int x, int y, ProfileBlock & block) {
+
+    if (block.orientation == HORIZONTAL) {
+        if (y + block.length > this->columns) {
+            return false;
+        }
+        // other horizontal blocks of the row end before the cursor, vertical ones to the right are not placed yet
+        for (int j = y + 1; j < y + block.length; j++) {
+            if (this->isForbidden[j * this->rows + x]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (x + block.length > this->rows) {
+        return false;
+    }
+    for (int i = x + 1; i < x + block.length; i++) {
+        if (this->isForbidden[y * this->rows + i] || this->digit(state, i) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ProfileSolver::sweepColumn(int y, vector<int> & states, vector<int> & values,
+                                vector<vector<int>> * parents, vector<vector<int8_t>> * choices) {
+
+    for (int x = 0; x < this->rows; x++) {
+        int k = y * this->rows + x;
+
+        vector<int> & nextStates = this->nextStates;
+        vector<int> & nextValues = this->nextValues;
+        nextStates.clear();
+        nextValues.clear();
+        vector<int> * parent = parents != nullptr ? &(*parents)[x] : nullptr;
+        vector<int8_t> * choice = choices != nullptr ? &(*choices)[x] : nullptr;
+        if (parent != nullptr) {
+            parent->clear();
+            choice->clear();
+        }
+
+        auto relax = [&](int next, int value, int from, int block) {
+            int & index = this->slot[next];
+            if (index == -1) {
+                index = nextStates.size();
+                nextStates.push_back(next);
+                nextValues.push_back(value);
+                if (parent != nullptr) {
+                    parent->push_back(from);
+                    choice->push_back(block);
+                }
+            } else if (value > nextValues[index]) {
+                nextValues[index] = value;
+                if (parent != nullptr) {
+                    (*parent)[index] = from;
+                    (*choice)[index] = block;
+                }
+            }
+        };
+
+        for (int s = 0; s < (int) states.size(); s++) {
+            int state = states[s];
+            int horizontal = this->digit(state, x);
+            int vertical = this->digit(state, this->rows);
+            int rest = state - horizontal * this->power[x] - vertical * this->power[this->rows];
+
+            // covered square, the block covering it moves one square closer to its end
+            if (horizontal > 0) {
+                relax(rest + (horizontal - 1) * this->power[x], values[s], s, -1);
+                continue;
+            }
+            if (vertical > 0) {
+                relax(rest + (vertical - 1) * this->power[this->rows], values[s], s, -1);
+                continue;
+            }
+
+            relax(rest, values[s], s, -1);
+            if (this->isForbidden[k]) {
+                continue;
+            }
+
+            for (int b = 0; b < (int) this->blocks.size(); b++) {
+                ProfileBlock & block = this->blocks[b];
+                if (!this->isBlockValid(state, x, y, block)) {
+                    continue;
+                }
+
+                int position = block.orientation == HORIZONTAL ? x : this->rows;
+                relax(rest + (block.length - 1) * this->power[position], values[s] + block.gain, s, b);
+            }
+        }
+
+        for (int next : nextStates) {
+            this->slot[next] = -1;
+        }
+        states.swap(nextStates);
+        values.swap(nextValues);
+    }
+}
+
+vector<Placement> ProfileSolver::solve(int & cost) {
+
+    this->slot.assign(this->stateCount, -1);
+
+    // profiles reached at the start of every stride-th column with their best price, the choices are not kept
+    // for any square, the columns are swept again from the closest kept layer once the best grid is rebuilt
+    int segments = (this->columns + this->stride - 1) / this->stride;
+    vector<vector<int>> keptStates(segments);
+    vector<vector<int>> keptValues(segments);
+
+    vector<int> states(1, 0);
+    vector<int> values(1, 0);
+    for (int y = 0; y < this->columns; y++) {
+        if (y % this->stride == 0) {
+            keptStates[y / this->stride] = states;
+            keptValues[y / this->stride] = values;
+        }
+        this->sweepColumn(y, states, values, nullptr, nullptr);
+    }
+
+    // every block ends inside the grid, so all profiles left are complete grids
+    int best = max_element(values.begin(), values.end()) - values.begin();
+    cost = values[best];
+    int target = states[best];
+
+    vector<Placement> placements;
+    vector<vector<int>> parents(this->rows);
+    vector<vector<int8_t>> choices(this->rows);
+    vector<vector<int>> columnStates(this->stride);
+    vector<vector<int>> columnValues(this->stride);
+    for (int segment = segments - 1; segment >= 0; segment--) {
+        int first = segment * this->stride;
+        int last = min(this->columns, first + this->stride);
+
+        // layers at the start of every column of the segment
+        columnStates[0].swap(keptStates[segment]);
+        columnValues[0].swap(keptValues[segment]);
+        for (int y = first + 1; y < last; y++) {
+            columnStates[y - first] = columnStates[y - first - 1];
+            columnValues[y - first] = columnValues[y - first - 1];
+            this->sweepColumn(y - 1, columnStates[y - first], columnValues[y - first], nullptr, nullptr);
+        }
+
+        for (int y = last - 1; y >= first; y--) {
+            states = columnStates[y - first];
+            values = columnValues[y - first];
+            this->sweepColumn(y, states, values, &parents, &choices);
+
+            int s = find(states.begin(), states.end(), target) - states.begin();
+            for (int x = this->rows - 1; x >= 0; x--) {
+                if (choices[x][s] >= 0) {
+                    ProfileBlock & block = this->blocks[choices[x][s]];
+                    placements.push_back(Placement{(int16_t) x, (int16_t) y,
+                                                   (int8_t) block.type, (int8_t) block.orientation, (int8_t) block.id});
+                }
+                s = parents[x][s];
+            }
+            target = columnStates[y - first][s];
+        }
+    }
+
+    return placements;
+}
@@ -0,0 +1,73 @@
+#ifndef COVERAGE_PROFILE_SOLVER_H
+#define COVERAGE_PROFILE_SOLVER_H
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+#include "../../model/grid.h"
+#include "../../model/coverage_problem.h"
+
+#define PROFILE_MAX_ROWS 12
+#define PROFILE_MAX_STATES (1 << 22)
+#define PROFILE_MAX_MEMORY (1LL << 29)
+#define PROFILE_MAX_WORK (1LL << 26)
+
+using namespace std;
+
+// block the dynamic programming may put on the cursor, with the price it adds
+struct ProfileBlock {
+    int type;
+    int orientation;
+    int id;
+    int length;
+    int gain;
+};
+
+// exact optimum of grids with few rows, walks the squares in the order of the search and keeps
+// the best price for every profile of blocks reaching past the cursor instead of branching
+class ProfileSolver {
+public:
+    ProfileSolver(CoverageProblem * problem);
+
+    // the table of profiles is small enough to be walked square by square, the kept layers fit into memory
+    // and the walk takes less than a second, above that the search usually cuts the grid down faster
+    bool isSolvable() {
+        return this->rows <= PROFILE_MAX_ROWS && this->stateCount <= PROFILE_MAX_STATES &&
+               this->memory <= PROFILE_MAX_MEMORY && this->work <= PROFILE_MAX_WORK;
+    }
+
+    // placements of an optimal grid, cost is set to the price they add to the empty one
+    vector<Placement> solve(int & cost);
+private:
+    int rows;
+    int columns;
+    // a profile holds a digit per row for the horizontal block crossing it and one for the vertical block below the cursor
+    int reach;
+    long long stateCount;
+    vector<int> power;
+    // columns between two kept layers and the bytes the layers, the table and the choices of a column may take
+    int stride;
+    long long memory;
+    // profiles moved over a square summed over the squares of the grid
+    long long work;
+
+    vector<uint8_t> isForbidden;
+    vector<ProfileBlock> blocks;
+
+    // index of a profile in the layer being built, -1 for profiles not reached yet
+    vector<int> slot;
+    // the layer being built, swapped with the current one after every square
+    vector<int> nextStates;
+    vector<int> nextValues;
+
+    int digit(int state, int position) { return state / this->power[position] % this->reach; }
+    bool isBlockValid(int state, int x, int y, ProfileBlock & block);
+    // moves the layer over one column, with parents it records the choice made on every square
+    void sweepColumn(int y, vector<int> & states, vector<int> & values,
+                     vector<vector<int>> * parents, vector<vector<int8_t>> * choices);
+};
+
+
+#endif //COVERAGE_PROFILE_SOLVER_H
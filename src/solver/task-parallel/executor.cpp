@@ -0,0 +1,137 @@
+#include "executor.h"
+
+WorkStealingExecutor::WorkStealingExecutor(int workers) {
+
+    this->pendingNodes = 0;
+    this->idleWorkers = 0;
+    this->isOpen = false;
+
+    for (int i = 0; i < workers; i++) {
+        WorkerQueue * queue = new WorkerQueue();
+        omp_init_lock(&queue->lock);
+        queue->size = 0;
+        queue->shallowestDepth = INT_MAX;
+        this->queues.push_back(queue);
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+
+    for (auto queue : this->queues) {
+        for (auto & node : queue->nodes) {
+            delete node.grid;
+        }
+        omp_destroy_lock(&queue->lock);
+        delete queue;
+    }
+}
+
+void WorkStealingExecutor::push(int worker, Grid * grid, Point & cord, int depth, int job) {
+
+    WorkerQueue * queue = this->queues[worker];
+
+    // counted before it is visible, so nobody sees zero pending nodes while it waits in the deque
+    this->pendingNodes++;
+
+    omp_set_lock(&queue->lock);
+    queue->nodes.push_back(SearchNode{grid, cord, depth, job});
+    queue->size.store(queue->nodes.size(), memory_order_relaxed);
+    queue->shallowestDepth.store(queue->nodes.front().depth, memory_order_relaxed);
+    omp_unset_lock(&queue->lock);
+}
+
+bool WorkStealingExecutor::pop(int worker, SearchNode & node) {
+
+    bool isIdle = false;
+
+    while (true) {
+
+        if (this->popOwn(worker, node) || this->steal(worker, node)) {
+            if (isIdle) {
+                this->idleWorkers--;
+            }
+            return true;
+        }
+
+        if (this->pendingNodes.load() == 0 && !this->isOpen.load()) {
+            if (isIdle) {
+                this->idleWorkers--;
+            }
+            return false;
+        }
+
+        // busy workers split their subtrees as long as someone is idle
+        if (!isIdle) {
+            this->idleWorkers++;
+            isIdle = true;
+        }
+
+        this_thread::yield();
+    }
+}
+
+bool WorkStealingExecutor::tryPop(int worker, SearchNode & node) {
+    return this->popOwn(worker, node) || this->steal(worker, node);
+}
+
+void WorkStealingExecutor::finish() {
+    this->pendingNodes--;
+}
+
+bool WorkStealingExecutor::popOwn(int worker, SearchNode & node) {
+
+    WorkerQueue * queue = this->queues[worker];
+    if (queue->size.load(memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    omp_set_lock(&queue->lock);
+
+    bool isPopped = !queue->nodes.empty();
+    if (isPopped) {
+        node = queue->nodes.back();
+        queue->nodes.pop_back();
+        queue->size.store(queue->nodes.size(), memory_order_relaxed);
+        queue->shallowestDepth.store(queue->nodes.empty() ? INT_MAX : queue->nodes.front().depth, memory_order_relaxed);
+    }
+
+    omp_unset_lock(&queue->lock);
+
+    return isPopped;
+}
+
+bool WorkStealingExecutor::steal(int thief, SearchNode & node) {
+
+    int workers = this->queues.size();
+
+    // the shallowest open node has the biggest subtree, depths are read without locking just to pick the victim
+    int victim = -1;
+    int shallowest = INT_MAX;
+    for (int i = 1; i < workers; i++) {
+        int candidate = (thief + i) % workers;
+        int depth = this->queues[candidate]->shallowestDepth.load(memory_order_relaxed);
+        if (depth < shallowest) {
+            shallowest = depth;
+            victim = candidate;
+        }
+    }
+
+    if (victim == -1) {
+        return false;
+    }
+
+    WorkerQueue * queue = this->queues[victim];
+    omp_set_lock(&queue->lock);
+
+    bool isStolen = !queue->nodes.empty();
+    if (isStolen) {
+        node = queue->nodes.front();
+        queue->nodes.pop_front();
+        queue->size.store(queue->nodes.size(), memory_order_relaxed);
+        queue->shallowestDepth.store(queue->nodes.empty() ? INT_MAX : queue->nodes.front().depth, memory_order_relaxed);
+    }
+
+    omp_unset_lock(&queue->lock);
+
+    return isStolen;
+}
@@ -0,0 +1,65 @@
+#ifndef COVERAGE_EXECUTOR_H
+#define COVERAGE_EXECUTOR_H
+
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <omp.h>
+
+#include "../../model/grid.h"
+#include "../../model/point.h"
+
+using namespace std;
+
+// open search node, the executor owns its grid until the node is popped
+struct SearchNode {
+    Grid * grid;
+    Point cord;
+    int depth;
+    // checkpoint job the node was split off
+    int job;
+};
+
+// open nodes of one worker, the owner works at the back and thieves take from the front
+struct WorkerQueue {
+    omp_lock_t lock;
+    deque<SearchNode> nodes;
+    atomic<int> size;
+    atomic<int> shallowestDepth;
+};
+
+// per worker deques of open nodes, owner goes deep first and idle workers steal the shallowest node
+class WorkStealingExecutor {
+public:
+    WorkStealingExecutor(int workers);
+    ~WorkStealingExecutor();
+
+    void push(int worker, Grid * grid, Point & cord, int depth, int job);
+    bool pop(int worker, SearchNode & node);
+    bool tryPop(int worker, SearchNode & node);
+    void finish();
+
+    // while open, workers wait for nodes even when none are pending
+    void open() { this->isOpen = true; }
+    void close() { this->isOpen = false; }
+    int getPendingNodes() { return this->pendingNodes.load(); }
+
+    // busy worker should split its subtree, someone is waiting for more than it has queued
+    bool isHungry(int worker) {
+        return this->queues[worker]->size.load(memory_order_relaxed) < this->idleWorkers.load(memory_order_relaxed);
+    }
+private:
+    vector<WorkerQueue *> queues;
+    // nodes pushed and not finished yet, workers quit once it drops to zero on a closed executor
+    atomic<int> pendingNodes;
+    atomic<int> idleWorkers;
+    atomic<bool> isOpen;
+
+    bool popOwn(int worker, SearchNode & node);
+    bool steal(int thief, SearchNode & node);
+};
+
+
+#endif //COVERAGE_EXECUTOR_H
@@ -0,0 +1,103 @@
+#include "transposition_table.h"
+
+TranspositionTable::TranspositionTable(CoverageProblem * problem) {
+
+    this->rows = problem->getRowSize();
+    this->columns = problem->getColumnSize();
+    this->reach = max(1, max(problem->getI1Length(), problem->getI2Length()));
+
+    mt19937_64 random(TRANSPOSITION_SEED);
+    this->squareKeys.resize(this->rows * this->columns);
+    this->cursorKeys.resize(this->rows * this->columns);
+    for (int k = 0; k < this->rows * this->columns; k++) {
+        this->squareKeys[k] = random();
+        this->cursorKeys[k] = random();
+    }
+
+    this->forbiddenMask.assign(this->columns, 0);
+    for (auto & point : problem->getForbiddenPoints()) {
+        this->forbiddenMask[point.getY()] |= 1ULL << point.getX();
+    }
+
+    // small grids have only a few frontiers, they do not need the full table
+    int freeSquares = this->rows * this->columns - problem->getForbiddenPoints().size();
+    int sizeLog = max(2, min(TRANSPOSITION_SIZE_LOG, freeSquares / 3));
+
+    this->entries = new TranspositionEntry[1ULL << sizeLog]();
+    this->bucketMask = ((1ULL << sizeLog) - 1) & ~(uint64_t) (TRANSPOSITION_BUCKET_SIZE - 1);
+}
+
+TranspositionTable::~TranspositionTable() {
+    delete [] this->entries;
+}
+
+uint64_t TranspositionTable::hash(Grid * grid, Point * cord) {
+
+    int x = cord->getX();
+    int y = cord->getY();
+
+    uint64_t key = this->cursorKeys[y * this->rows + x];
+
+    // squares before the cursor are final, columns past the reach hold nothing but forbidden squares
+    int lastColumn = min(this->columns, y + this->reach);
+    for (int j = y; j < lastColumn; j++) {
+        uint64_t covered = grid->getColumnMask(j) & ~this->forbiddenMask[j];
+        if (j == y) {
+            covered &= ~0ULL << x;
+        }
+
+        while (covered != 0) {
+            key ^= this->squareKeys[j * this->rows + __builtin_ctzll(covered)];
+            covered &= covered - 1;
+        }
+    }
+
+    return key;
+}
+
+bool TranspositionTable::probe(uint64_t key, int & bound) {
+
+    TranspositionEntry * bucket = this->entries + (key & this->bucketMask);
+
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++) {
+        uint64_t data = bucket[i].data.load(memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(memory_order_relaxed);
+        if (data != 0 && (check ^ data) == key) {
+            bound = (int) (uint32_t) data;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int bound, int squares) {
+
+    TranspositionEntry * bucket = this->entries + (key & this->bucketMask);
+
+    // the same frontier keeps the tighter bound, otherwise the smallest subtree makes room
+    TranspositionEntry * victim = bucket;
+    int victimSquares = INT_MAX;
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++) {
+        uint64_t data = bucket[i].data.load(memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(memory_order_relaxed);
+
+        if (data != 0 && (check ^ data) == key) {
+            if ((int) (uint32_t) data <= bound) {
+                return;
+            }
+            victim = bucket + i;
+            break;
+        }
+
+        int entrySquares = (int) (data >> 32);
+        if (entrySquares < victimSquares) {
+            victim = bucket + i;
+            victimSquares = entrySquares;
+        }
+    }
+
+    uint64_t data = ((uint64_t) squares << 32) | (uint32_t) bound;
+    victim->data.store(data, memory_order_relaxed);
+    victim->check.store(key ^ data, memory_order_relaxed);
+}
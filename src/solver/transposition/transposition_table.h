@@ -0,0 +1,55 @@
+#ifndef COVERAGE_TRANSPOSITION_TABLE_H
+#define COVERAGE_TRANSPOSITION_TABLE_H
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <cstdint>
+#include <climits>
+
+#include "../../model/grid.h"
+#include "../../model/coverage_problem.h"
+
+#define TRANSPOSITION_SIZE_LOG 20
+#define TRANSPOSITION_BUCKET_SIZE 4
+#define TRANSPOSITION_SEED 0x5eed
+
+using namespace std;
+
+// one slot, the key is stored xor'ed with the data so a half written slot never matches
+struct TranspositionEntry {
+    atomic<uint64_t> check;
+    atomic<uint64_t> data;
+};
+
+// bounded table of the best price still reachable behind a column frontier, shared by all threads without locks
+class TranspositionTable {
+public:
+    TranspositionTable(CoverageProblem * problem);
+    ~TranspositionTable();
+
+    // Zobrist key of the cursor and the covered squares a block placed from it on can still touch
+    uint64_t hash(Grid * grid, Point * cord);
+
+    // false when nothing is known about the key
+    bool probe(uint64_t key, int & bound);
+    // squares tell how big the searched subtree was, small ones are replaced first
+    void store(uint64_t key, int bound, int squares);
+private:
+    int rows;
+    int columns;
+    // columns a horizontal block starting in the cursor column reaches
+    int reach;
+
+    vector<uint64_t> squareKeys;
+    vector<uint64_t> cursorKeys;
+    // forbidden squares never change, they are left out of the key
+    vector<uint64_t> forbiddenMask;
+
+    TranspositionEntry * entries;
+    uint64_t bucketMask;
+};
+
+
+#endif //COVERAGE_TRANSPOSITION_TABLE_H